@@ -0,0 +1,69 @@
+/* Convert a text distance file (square or lower-triangular, as written
+ * by distgen) into the binary format read by wsp-mpi_v4:
+ *
+ *   char     magic[4]   "WSPB"
+ *   uint32_t version    1
+ *   uint32_t n
+ *   uint32_t reserved   0
+ *   int32_t  dist[n][n] row-major, native byte order
+ *
+ * usage: dist2bin <text-file> <binary-file>
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char **argv)
+{
+  FILE *in, *out;
+  int n, cnt = 0, i, j, k;
+  int32_t *nums, *dist;
+  uint32_t header[3];
+
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s <text-file> <binary-file>\n", argv[0]);
+    return 1;
+  }
+
+  in = fopen(argv[1], "r");
+  if (!in) { perror(argv[1]); return 1; }
+  if (fscanf(in, "%d", &n) != 1 || n <= 0) {
+    fprintf(stderr, "%s: missing city count\n", argv[1]);
+    return 1;
+  }
+
+  nums = malloc(((size_t)n * n + 1) * sizeof(int32_t));
+  dist = calloc((size_t)n * n, sizeof(int32_t));
+  if (!nums || !dist) { perror("malloc"); return 1; }
+  while (cnt <= n * n && fscanf(in, "%d", &nums[cnt]) == 1) cnt++;
+  fclose(in);
+
+  if (cnt == n * n) {
+    for (k = 0; k < n * n; k++) dist[k] = nums[k];
+  } else if (cnt == n * (n - 1) / 2) {
+    for (i = 1, k = 0; i < n; i++)
+      for (j = 0; j < i; j++, k++)
+        dist[i * n + j] = dist[j * n + i] = nums[k];
+  } else {
+    fprintf(stderr, "%s: %d values, need %d (square) or %d (triangular)\n",
+            argv[1], cnt, n * n, n * (n - 1) / 2);
+    return 1;
+  }
+
+  out = fopen(argv[2], "wb");
+  if (!out) { perror(argv[2]); return 1; }
+  header[0] = 1;
+  header[1] = (uint32_t)n;
+  header[2] = 0;
+  if (fwrite("WSPB", 1, 4, out) != 4 ||
+      fwrite(header, sizeof(header), 1, out) != 1 ||
+      fwrite(dist, sizeof(int32_t), (size_t)n * n, out) != (size_t)n * n) {
+    perror(argv[2]);
+    return 1;
+  }
+  fclose(out);
+
+  free(nums);
+  free(dist);
+  return 0;
+}
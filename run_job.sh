@@ -7,6 +7,11 @@
 # If qsub exists → submits PBS job with requested resources
 # Else → runs mpirun locally and writes output to file
 #
+# With WSP_PROFILE=<file>, v4 runs use the threads per rank tuned for the
+# instance's size class and ppn/threads ranks per node.  With WSP_TUNE=1
+# as well, the job instead probes every ranks × threads split of ppn with
+# `wsp-mpi_v4 --autotune` and saves the winners to that profile.
+#
 
 set -euo pipefail
 
@@ -18,6 +23,14 @@ WALLTIME_MINUTES=30
 # Available versions
 AVAILABLE_VERSIONS=("wsp-mpi" "wsp-mpi_v2" "wsp-mpi_v3" "wsp-mpi_v4")
 
+# Tuning profile (see header); seconds per probe when tuning
+PROFILE=${WSP_PROFILE:-""}
+TUNE=${WSP_TUNE:-0}
+TUNE_BUDGET=${WSP_TUNE_BUDGET:-10}
+
+# Split chosen from the profile (set in main)
+THREADS=""
+
 # Error codes
 E_BADARGS=65
 
@@ -60,6 +73,66 @@ usage() {
     echo "  • If 'qsub' command exists → submits PBS job"
     echo "  • Otherwise → runs locally with mpirun"
     echo "  • Version auto-detection prefers: v4 > v3 > v2 > basic"
+    echo ""
+    echo "Environment (wsp-mpi_v4 only):"
+    echo "  WSP_PROFILE=FILE   Use the tuned threads per rank and settings in FILE"
+    echo "  WSP_TUNE=1         Tune ranks × threads for the input and save to WSP_PROFILE"
+    echo "  WSP_TUNE_BUDGET=S  Seconds per tuning probe (default 10)"
+}
+
+# City count of a distance file: WSPB binary, coordinates or text matrix
+instance_size() {
+    local file=$1
+    if [[ $(head -c 4 "$file") == "WSPB" ]]; then
+        od -An -tu4 -j8 -N4 "$file" | tr -d ' '
+    elif grep -q "^ *City" "$file"; then
+        grep -c "^ *City" "$file"
+    else
+        awk '{ print $1; exit }' "$file"
+    fi
+}
+
+# Threads per rank the profile chose for this size class: the entry with
+# the nearest n, fastest first (the same rule as wsp-mpi_v4 --profile)
+profile_threads() {
+    local profile=$1
+    local n=$2
+    [[ -f "$profile" ]] || return 0
+    awk -v n="$n" '
+        $1 ~ /^n=/ {
+            for (i = 1; i <= NF; i++) { split($i, kv, "="); v[kv[1]] = kv[2] }
+            d = v["n"] - n; if (d < 0) d = -d
+            if (best == "" || d < bd || (d == bd && v["seconds"] + 0 < bs)) {
+                best = v["threads"]; bd = d; bs = v["seconds"] + 0
+            }
+        }
+        END { if (best != "") print best }' "$profile"
+}
+
+# Print the solver command line(s) for the job: one mpirun normally, or
+# one --autotune run per ranks × threads split of ppn when tuning
+solver_commands() {
+    local nodes=$1
+    local ppn=$2
+    local inputfile=$3
+    local program=$4
+    local launcher=$5
+
+    if [[ $TUNE == 1 && $program == "wsp-mpi_v4" ]]; then
+        local t
+        for ((t = 1; t <= ppn; t *= 2)); do
+            (( ppn % t == 0 )) || continue
+            echo "OMP_NUM_THREADS=$t $launcher -x OMP_NUM_THREADS --map-by ppr:$((ppn / t)):node" \
+                 "-np $((nodes * ppn / t)) ./$program --autotune $PROFILE" \
+                 "--autotune-budget $TUNE_BUDGET $inputfile"
+        done
+    elif [[ -n $THREADS ]]; then
+        local rpn=$(( ppn / THREADS > 0 ? ppn / THREADS : 1 ))
+        echo "OMP_NUM_THREADS=$THREADS $launcher -x OMP_NUM_THREADS --map-by ppr:$rpn:node" \
+             "-np $((nodes * rpn)) ./$program --profile $PROFILE $inputfile"
+    else
+        echo "$launcher -np $((nodes * ppn)) ./$program $inputfile"
+    fi
 }
 
 # Function to select best available version
@@ -130,6 +203,8 @@ generate_pbs_script() {
     local inputfile=$4
     local program=$5
     local total_procs=$((nodes * ppn))
+    local commands=$(solver_commands $nodes $ppn $inputfile $program \
+        'mpirun --mca btl_tcp_if_include em1,eth0 --mca plm_rsh_agent ssh -host "$HOSTS"')
     
     local pbs_script="${outfile%.log}.pbs"
     
@@ -177,17 +252,16 @@ export OMPI_MCA_btl_tcp_if_include=em1,eth0
 export OMPI_MCA_plm_rsh_agent=ssh
 
 # Run the TSP solver
-echo "Executing: mpirun -host \$HOSTS -np ${total_procs} ./${program} ${inputfile}"
+cat << 'CMDS'
+Executing:
+${commands}
+CMDS
 echo ""
 
 # Time the execution
 START_TIME=\$(date +%s.%N)
 
-mpirun --mca btl_tcp_if_include em1,eth0 \\
-       --mca plm_rsh_agent ssh \\
-       -host "\$HOSTS" \\
-       -np ${total_procs} \\
-       ./${program} ${inputfile}
+${commands}
 
 EXIT_CODE=\$?
 END_TIME=\$(date +%s.%N)
@@ -265,24 +339,18 @@ run_local() {
         echo "Warning: Requesting ${total_procs} ranks but only ${available_cores} cores available"
         echo "Using --oversubscribe flag for time-sharing"
         echo ""
-        echo "Executing: mpirun --oversubscribe -np ${total_procs} ./${program} ${inputfile}"
-        echo ""
-        
-        # Time the execution
-        START_TIME=$(date +%s.%N)
-        mpirun --oversubscribe -np $total_procs ./$program $inputfile
-        EXIT_CODE=$?
-        END_TIME=$(date +%s.%N)
+        local commands=$(solver_commands $nodes $ppn $inputfile $program "mpirun --oversubscribe")
     else
-        echo "Executing: mpirun -np ${total_procs} ./${program} ${inputfile}"
-        echo ""
-        
-        # Time the execution
-        START_TIME=$(date +%s.%N)
-        mpirun -np $total_procs ./$program $inputfile
-        EXIT_CODE=$?
-        END_TIME=$(date +%s.%N)
+        local commands=$(solver_commands $nodes $ppn $inputfile $program "mpirun")
     fi
+    echo "Executing:"
+    echo "$commands"
+    echo ""
+
+    # Time the execution
+    START_TIME=$(date +%s.%N)
+    eval "$commands" && EXIT_CODE=0 || EXIT_CODE=$?
+    END_TIME=$(date +%s.%N)
     
     WALL_TIME=$(echo "$END_TIME - $START_TIME" | bc -l 2>/dev/null || echo "N/A")
     
@@ -384,6 +452,17 @@ main() {
         exit $E_BADARGS
     fi
     
+    # Tuned split for v4, unless this job is the tuning run
+    if [[ -n $PROFILE && $program == "wsp-mpi_v4" ]]; then
+        if [[ $TUNE != 1 ]]; then
+            THREADS=$(profile_threads "$PROFILE" "$(instance_size "$inputfile")")
+            [[ -n $THREADS ]] || echo -e "${YELLOW}No profile entry in ${PROFILE}; using defaults${NC}"
+        fi
+    elif [[ $TUNE == 1 ]]; then
+        echo -e "${RED}Error: WSP_TUNE=1 needs WSP_PROFILE and wsp-mpi_v4${NC}" >&2
+        exit $E_BADARGS
+    fi
+
     # Print job summary
     echo -e "${BLUE}===============================================${NC}"
     echo -e "${BLUE}           TSP Solver Job Submission${NC}"
@@ -391,6 +470,8 @@ main() {
     echo "Nodes: $nodes"
     echo "Processors per node: $ppn"
     echo "Total MPI ranks: $((nodes * ppn))"
+    [[ -n $THREADS ]] && echo "Profile split: $(( ppn / THREADS > 0 ? ppn / THREADS : 1 )) ranks/node × ${THREADS} threads"
+    [[ $TUNE == 1 ]] && echo "Tuning into: ${PROFILE} (${TUNE_BUDGET} s per probe)"
     echo "Program version: $program"
     echo "Input file: $inputfile"
     echo "Output file: $outfile"
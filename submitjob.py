@@ -13,7 +13,7 @@ from pathlib import Path
 
 # ------------------------------- helper: usage -------------------------
 def usage(name: str) -> None:
-    print(f"""Usage: {name} -h -J -s NAME -p PROCS -a ARGS -r ROOT -d DIGITS
+    print(f"""Usage: {name} -h -J -s NAME -p PROCS -a ARGS -r ROOT -d DIGITS -P PROFILE
   -h         Print this message
   -J         Don't submit job (just generate command file)
   -s NAME    Root name of generated script (default "latedays")
@@ -21,6 +21,9 @@ def usage(name: str) -> None:
   -a ARGS    Argument string passed to ./wsp-mpi (quoted)
   -r ROOT    Root name of benchmark output file (informational)
   -d DIGITS  Length of random numeric suffix appended to names (default 4)
+  -P PROFILE Run ./wsp-mpi_v4 with the threads per rank tuned in PROFILE
+             (wsp-mpi_v4 --autotune) for the input, the last word of ARGS;
+             PROCS is then split into PROCS/threads ranks
 """)
     sys.exit(0)
 
@@ -35,12 +38,41 @@ def generate_id(digits: int) -> str:
 def make_name(root: str, ext: str) -> str:
     return f"{root}-{unique_id}.{ext}" if unique_id else f"{root}.{ext}"
 
+# ------------------------------- helper: tuning profile ---------------
+def instance_size(path: str) -> int:
+    """City count of a distance file (WSPB binary, coordinates or text)."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] == b"WSPB":
+        return int.from_bytes(data[8:12], sys.byteorder)
+    text = data.decode(errors="replace")
+    cities = sum(1 for line in text.splitlines()
+                 if line.lstrip().startswith("City"))
+    return cities if cities else int(text.split()[0])
+
+def profile_threads(profile: str, n: int) -> int:
+    """Threads per rank of the profile entry with the nearest city count,
+    fastest first (the rule wsp-mpi_v4 --profile applies); 0 if none."""
+    best = None
+    with open(profile) as f:
+        for line in f:
+            if not line.startswith("n="):
+                continue
+            e = dict(kv.split("=", 1) for kv in line.split())
+            key = (abs(int(e["n"]) - n), float(e["seconds"]))
+            if best is None or key < best[0]:
+                best = (key, int(e["threads"]))
+    return best[1] if best else 0
+
 # ------------------------------- script generator ----------------------
 def generate_script(script: Path,
                     procs: int,
                     arg_string: str,
-                    output_name: str) -> bool:
-    """Write a PBS shell script that runs wsp-mpi with <procs> ranks."""
+                    output_name: str,
+                    program: str = "./wsp-mpi",
+                    threads: int = 0) -> bool:
+    """Write a PBS shell script that runs <program> with <procs> ranks
+    (and <threads> OpenMP threads each, if set)."""
     try:
         with script.open("w") as f:
             f.write("#!/bin/bash\n"
@@ -48,8 +80,12 @@ def generate_script(script: Path,
                     "#PBS -l walltime=0:30:00         # 30-minute limit\n"
                     "#PBS -l nodes=1:ppn=24           # single 24-core node\n\n"
                     "cd \"$PBS_O_WORKDIR\"\n\n"
+                    + (f"export OMP_NUM_THREADS={threads}\n\n"
+                       if threads else "") +
                     f"# Run program; summary will appear in {output_name}\n"
-                    f"mpirun -np {procs} ./wsp-mpi {arg_string}\n")
+                    f"mpirun -np {procs} "
+                    + ("-x OMP_NUM_THREADS " if threads else "") +
+                    f"{program} {arg_string}\n")
         script.chmod(0o755)
         return True
     except OSError as e:
@@ -76,8 +112,9 @@ def run(argv):
     output_root  = "benchmark"
     output_ext   = "out"
     digits       = 4
+    profile      = ""
 
-    optlist, _ = getopt.getopt(argv, "hJp:s:a:r:d:")
+    optlist, _ = getopt.getopt(argv, "hJp:s:a:r:d:P:")
     for opt, val in optlist:
         if opt == "-h":
             usage(sys.argv[0])
@@ -93,12 +130,34 @@ def run(argv):
             output_root = val
         elif opt == "-d":
             digits = int(val)
+        elif opt == "-P":
+            profile = val
+
+    program = "./wsp-mpi"
+    threads = 0
+    if profile:
+        if not arg_string:
+            print("Error: -P needs the input file as the last word of -a")
+            sys.exit(1)
+        try:
+            n = instance_size(arg_string.split()[-1])
+            threads = profile_threads(profile, n)
+        except (OSError, ValueError, KeyError, IndexError) as e:
+            print(f"Error: couldn't read profile '{profile}': {e}")
+            sys.exit(1)
+        if threads:
+            procs = max(1, procs // threads)
+        else:
+            print(f"Warning: no entry in '{profile}'; using default threads")
+        program = "./wsp-mpi_v4"
+        arg_string = f"--profile {profile} {arg_string}"
 
     unique_id   = generate_id(digits)
     script_name = Path(make_name(script_root, script_ext))
     output_name = make_name(output_root, output_ext)
 
-    if generate_script(script_name, procs, arg_string, output_name):
+    if generate_script(script_name, procs, arg_string, output_name,
+                       program, threads):
         print(f"Generated script {script_name}")
         if submit_job:
             submit(script_name)
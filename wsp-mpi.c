@@ -3,6 +3,10 @@
  *
  *  wsp-mpi.c  —  Branch-and-bound Travelling-Salesman solver
  *                using MPI across ≤ 18 cities.
+ *
+ *  Default mode: rank 0 hands out tasks on request (master/worker).
+ *  --rma mode:   every rank seeds the same task list and claims the next
+ *                index with MPI_Fetch_and_op on a counter held by rank 0.
  *--------------------------------------------------------------------*/
 
 #include <mpi.h>
@@ -139,14 +143,12 @@ static void dfs_from_task(const Task *t)
 }
 
 /* --------------------------------------------------------------------
- * master()  —  rank 0: distribute work and handle single-process case
+ * seed_tasks()  —  one task per first hop: city 0 → i  for i = 1..N-1
  */
-static void master(int world)
+static int seed_tasks(Task *queue)
 {
-    Task queue[MAX_N];
-    int  qsz = 0;
+    int qsz = 0;
 
-    /* ---- seed: city 0 → i  for i = 1..N-1 ------------------------ */
     for (int i = 1; i < N; ++i) {
         queue[qsz] = (Task){
             .depth       = 2,                    /* path: 0 → i */
@@ -159,6 +161,16 @@ static void master(int world)
         queue[qsz].path[1] = i;
         qsz++;
     }
+    return qsz;
+}
+
+/* --------------------------------------------------------------------
+ * master()  —  rank 0: distribute work and handle single-process case
+ */
+static void master(int world)
+{
+    Task queue[MAX_N];
+    int  qsz = seed_tasks(queue);
 
     /* If single process, master does all the work */
     if (world == 1) {
@@ -209,6 +221,39 @@ static void worker(void)
     }
 }
 
+/* --------------------------------------------------------------------
+ * rma_search()  —  all ranks: claim tasks from a shared counter
+ *
+ * The seed list depends only on the broadcast matrix, so each rank builds
+ * its own copy and only the next-task index lives in an RMA window on
+ * rank 0.  A claim is one MPI_Fetch_and_op; rank 0 searches like everyone
+ * else.  Tasks are claimed from the back, the same order master() uses.
+ */
+static void rma_search(int rank)
+{
+    Task queue[MAX_N];
+    int  qsz = seed_tasks(queue);
+
+    int     *counter;
+    MPI_Win  win;
+    MPI_Win_allocate(rank == 0 ? sizeof(int) : 0, sizeof(int),
+                     MPI_INFO_NULL, MPI_COMM_WORLD, &counter, &win);
+    if (rank == 0) *counter = 0;
+    MPI_Barrier(MPI_COMM_WORLD);    /* counter is zero before any claim */
+
+    const int one = 1;
+    MPI_Win_lock_all(0, win);
+    while (1) {
+        int next;
+        MPI_Fetch_and_op(&one, &next, MPI_INT, 0, 0, MPI_SUM, win);
+        MPI_Win_flush(0, win);
+        if (next >= qsz) break;
+        dfs_from_task(&queue[qsz - 1 - next]);
+    }
+    MPI_Win_unlock_all(win);
+    MPI_Win_free(&win);
+}
+
 /* --------------------------------------------------------------------
  * read_distance_file()  —  supports both full and triangular formats
  */
@@ -278,15 +323,16 @@ int main(int argc, char **argv)
     MPI_Comm_size(MPI_COMM_WORLD, &world);
 
     /* validate CLI */
-    if (argc != 2) {
+    int use_rma = argc == 3 && strcmp(argv[1], "--rma") == 0;
+    if (argc != 2 && !use_rma) {
         if (rank == 0)
-            fprintf(stderr, "usage: %s <distance-file>\n", argv[0]);
+            fprintf(stderr, "usage: %s [--rma] <distance-file>\n", argv[0]);
         MPI_Finalize(); 
         return 1;
     }
 
     /* read & broadcast distance matrix */
-    if (rank == 0) read_distance_file(argv[1]);
+    if (rank == 0) read_distance_file(argv[argc - 1]);
 
     MPI_Bcast(&N, 1, MPI_INT, 0, MPI_COMM_WORLD);
     MPI_Bcast(dist, MAX_N * MAX_N, MPI_INT, 0, MPI_COMM_WORLD);
@@ -298,8 +344,9 @@ int main(int argc, char **argv)
     double t0 = MPI_Wtime();
 
     /* run search */
-    if (rank == 0) master(world);
-    else           worker();
+    if (use_rma)        rma_search(rank);
+    else if (rank == 0) master(world);
+    else                worker();
 
     /* gather global optimum AFTER all work is done */
     int global_best;
@@ -6,7 +6,7 @@
  *  2. 2-edge lower bounds with incremental updates
  *  3. Branch ordering for better pruning
  *  4. Bit-scan mask operations
- *  5. Pre-allocated stacks
+ *  5. Pre-allocated stacks, sized exactly from N
  *--------------------------------------------------------------------*/
 
 #include <mpi.h>
@@ -17,7 +17,6 @@
 
 #define MAX_N            19
 #define MAX_PATH         MAX_N
-#define MAX_STACK_SIZE   (1 << 18)    /* Pre-allocated stack size */
 
 enum { TAG_REQ = 1, TAG_WORK, TAG_NOWORK, TAG_BOUND = 5 };
 
@@ -33,7 +32,11 @@ typedef struct {
 typedef struct {
     int cheapest1[MAX_N];   /* Cheapest edge from each city */
     int cheapest2[MAX_N];   /* Second cheapest edge from each city */
+    int cheapest_in[MAX_N]; /* Cheapest edge into each city */
+    int half[MAX_N];        /* Per-city share of any path through it */
     int city_order[MAX_N];  /* Cities sorted by average outgoing cost */
+    int neighbours[MAX_N][MAX_N - 1];  /* Other cities, nearest first */
+    int neighbour_rank[MAX_N][MAX_N];  /* Position of j in neighbours[i] */
 } BoundInfo;
 
 /* Global state */
@@ -50,9 +53,24 @@ typedef struct {
     int parent_lb;  /* Incremental lower bound */
 } Node;
 
-/* Precompute enhanced bounds */
+/* Precompute enhanced bounds.  A tour enters and leaves every city
+ * once: on a symmetric matrix through two distinct edges at the city,
+ * on an asymmetric one through an edge of its column and one of its
+ * row, so its share is half the two cheapest edges or half the
+ * cheapest edges in and out. */
 static void precompute_enhanced_bounds(void)
 {
+    int directed = 0;
+    for (int j = 0; j < N; j++) {
+        int min_in = INT_MAX;
+        for (int i = 0; i < N; i++) {
+            if (i == j) continue;
+            if (dist[i][j] < min_in) min_in = dist[i][j];
+            if (dist[i][j] != dist[j][i]) directed = 1;
+        }
+        bounds.cheapest_in[j] = (min_in == INT_MAX) ? 0 : min_in;
+    }
+
     for (int i = 0; i < N; i++) {
         int min1 = INT_MAX, min2 = INT_MAX;
         
@@ -69,6 +87,22 @@ static void precompute_enhanced_bounds(void)
         
         bounds.cheapest1[i] = (min1 == INT_MAX) ? 0 : min1;
         bounds.cheapest2[i] = (min2 == INT_MAX) ? 0 : min2;
+        bounds.half[i] = (bounds.cheapest1[i] +
+                          (directed ? bounds.cheapest_in[i] : bounds.cheapest2[i])) / 2;
+
+        /* Branch order for children of i: insertion sort by distance */
+        int *nb = bounds.neighbours[i];
+        int count = 0;
+        for (int j = 0; j < N; j++) {
+            if (j == i) continue;
+            int k = count++;
+            while (k > 0 && dist[i][nb[k - 1]] > dist[i][j]) {
+                nb[k] = nb[k - 1];
+                k--;
+            }
+            nb[k] = j;
+        }
+        for (int k = 0; k < N - 1; k++) bounds.neighbour_rank[i][nb[k]] = k;
     }
     
     /* Sort cities by average outgoing cost for better branch ordering */
@@ -102,7 +136,7 @@ static inline int lower_bound_2edge(int cost, int mask)
     int unvisited = (~mask) & ((1 << N) - 1);
     while (unvisited) {
         int i = __builtin_ctz(unvisited);  /* Count trailing zeros */
-        lb += (bounds.cheapest1[i] + bounds.cheapest2[i]) / 2;
+        lb += bounds.half[i];
         unvisited &= unvisited - 1;  /* Clear lowest set bit */
     }
     
@@ -112,8 +146,7 @@ static inline int lower_bound_2edge(int cost, int mask)
 /* Incremental lower bound update */
 static inline int incremental_lower_bound(int parent_lb, int prev_city, int cur_city)
 {
-    return parent_lb + dist[prev_city][cur_city] - 
-           (bounds.cheapest1[cur_city] + bounds.cheapest2[cur_city]) / 2;
+    return parent_lb + dist[prev_city][cur_city] - bounds.half[cur_city];
 }
 
 /* Create MPI derived datatype for Task */
@@ -137,8 +170,11 @@ static void enhanced_dfs_worker(const Task *initial_tasks, int num_tasks)
 {
     if (num_tasks == 0) return;
     
-    /* Pre-allocated stack - no malloc/realloc in hot path */
-    Node *stack = malloc(MAX_STACK_SIZE * sizeof(Node));
+    /* Pre-allocated stack - no malloc/realloc in hot path.  Above the
+     * initial tasks, LIFO order leaves at most N - d - 1 unexplored
+     * siblings per depth d >= 2, so the stack can never overflow. */
+    const int capacity = num_tasks + (N - 2) * (N - 3) / 2 + 1;
+    Node *stack = malloc(capacity * sizeof(Node));
     if (!stack) { perror("malloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
     
     int sp = 0;
@@ -178,32 +214,23 @@ static void enhanced_dfs_worker(const Task *initial_tasks, int num_tasks)
             continue;
         }
 
-        /* Expand children with branch ordering */
-        int children[MAX_N];
-        int child_count = 0;
-        
-        /* Collect unvisited cities using bit operations */
+        /* Map the unvisited cities to their positions in the precomputed
+         * nearest-first order; scanning that mask from the top yields the
+         * children farthest first in O(children), with no sort */
+        const int *nb = bounds.neighbours[n.city];
+        const int *rank_of = bounds.neighbour_rank[n.city];
+        unsigned order = 0;
         int unvisited = (~n.visitedMask) & ((1 << N) - 1);
         while (unvisited) {
-            int city = __builtin_ctz(unvisited);  /* Count trailing zeros */
-            children[child_count++] = city;
-            unvisited &= unvisited - 1;  /* Clear lowest set bit */
-        }
-        
-        /* Sort children by distance for better branch ordering */
-        for (int i = 0; i < child_count - 1; i++) {
-            for (int j = i + 1; j < child_count; j++) {
-                if (dist[n.city][children[i]] > dist[n.city][children[j]]) {
-                    int temp = children[i];
-                    children[i] = children[j];
-                    children[j] = temp;
-                }
-            }
+            order |= 1u << rank_of[__builtin_ctz(unvisited)];
+            unvisited &= unvisited - 1;
         }
         
         /* Add children in reverse order (stack is LIFO) */
-        for (int c = child_count - 1; c >= 0; c--) {
-            int next = children[c];
+        while (order) {
+            int r = 31 - __builtin_clz(order);
+            order &= ~(1u << r);
+            int next = nb[r];
             int new_cost = n.cost + dist[n.city][next];
             
             /* Early cost pruning */
@@ -219,9 +246,6 @@ static void enhanced_dfs_worker(const Task *initial_tasks, int num_tasks)
                 if (final_cost >= best_cost) continue;
             }
             
-            /* Stack overflow check */
-            if (sp >= MAX_STACK_SIZE - 1) continue;
-            
             stack[sp] = n;
             stack[sp].city = next;
             stack[sp].cost = new_cost;
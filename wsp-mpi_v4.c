@@ -7,81 +7,602 @@
  *  3. Branch ordering for better pruning
  *  4. Bit-scan mask operations
  *  5. Owner-computes seeding
+ *  6. Inter-rank work stealing with Safra termination detection
+ *  7. Configurable-depth prefix seeding for fine-grained tasks
+ *  8. Asynchronous global incumbent sharing through an MPI_MIN window
+ *  9. Per-thread Chase-Lev deques with intra-rank work stealing
+ * 10. Compact DFS nodes with byte-packed paths kept apart
+ * 11. 64-bit masks and a heap-allocated, row-padded distance matrix
+ * 12. Optional Held-Karp dynamic-programming engine (--engine hk)
+ * 13. Optional Lagrangian 1-tree bound at shallow depths (--bound 1tree)
+ * 14. Heuristic warm-start incumbent (nearest neighbour + 2-opt/Or-opt)
+ * 15. AVX-512/AVX2 child-expansion kernel with a scalar fallback
+ * 16. Optional lock-free dominance table on (visited set, city)
+ * 17. Suffix completion table for the last k cities
+ * 18. Symmetry breaking on symmetric matrices (one tour orientation)
+ * 19. Memory-mapped binary matrices and direct coordinate input
+ * 20. Batch mode: many instances per job on right-sized sub-communicators
+ * 21. Asynchronous frontier checkpoints, restartable on any rank count
+ * 22. Per-thread search counters reduced into a JSON report (--stats)
+ * 23. Anytime mode: streamed incumbents, time limit and gap stop
+ * 24. Node-shared matrix, bound tables and incumbent (MPI-3 shared windows)
+ * 25. DFS kernels specialised on the city count, dispatched per instance
+ * 26. Directed 2-edge bound (cheapest edges out and in) on asymmetric input
+ * 27. Seeds dealt by Knuth-estimated subtree size, longest first (--probes)
+ * 28. Per-thread event rings written as one Chrome trace per run (--trace)
+ * 29. In-process benchmark harness with scaling sweeps (-DWSP_BENCH)
+ * 30. Optional memory-bounded best-first phase ahead of the DFS (--best-first)
+ * 31. Hugepage-backed, first-touch tables; per-NUMA-domain replicas (--numa)
+ * 32. Auto-tuner writing per-size profiles read back by --profile (--autotune)
  *--------------------------------------------------------------------*/
 
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE             /* madvise(MADV_HUGEPAGE) */
+
 #include <mpi.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
-#define MAX_N            19
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#define MAX_N            64           /* visitedMask is 64 bits wide */
 #define MAX_PATH         MAX_N
-#define MAX_STACK_SIZE   (1 << 16)    /* Stack size per thread */
+#define DIST_ALIGN       16           /* Row stride multiple: one cache line */
+#define STEAL_CHUNK      16           /* Max tasks handed over per steal */
+#define STEAL_POLL_INTERVAL 1024      /* Node pops between request polls */
+#define SEED_TASKS_PER_THREAD 8       /* Auto seeding target per worker */
+#define BOUND_UPDATE_INTERVAL 4096    /* Node pops between incumbent exchanges */
+#define BEST_FIRST_BATCH 64           /* Heap nodes per thread per best-first round */
+#define HK_MAX_N         30           /* Held-Karp table indices stay in range */
+#define ONETREE_ITERS    200          /* Subgradient steps at the root */
+#define SUFFIX_BUDGET_MB 8            /* Auto --suffix-k keeps the table below this */
+#define SUFFIX_MAX_K     14
+#define BATCH_CLASSES    4            /* Batch groups of 1, 2, 4 and 8 ranks */
+#define FILE_NAME_MAX    1024         /* Manifest entries, checkpoint prefixes */
+#define CHECKPOINT_INTERVAL 600       /* Default seconds between checkpoints */
+#define TT_WAYS          4            /* Entries per bucket: one cache line */
+#define TT_MERGE_ENTRIES 4096         /* Entries shipped per ring merge */
+#define TT_MERGE_INTERVAL 16          /* Incumbent polls between merges */
+#define TRACE_EVENTS     (1 << 16)    /* Ring slots per thread for --trace */
+#define HUGE_PAGE        (2u << 20)   /* Transparent hugepage size */
+#define TUNE_BUDGET      10.0         /* Default seconds per tuning probe */
+#define PROFILE_MAX      256          /* Entries kept in a profile file */
+
+/* City counts that get a search kernel of their own (see dfs_thread);
+ * -DWSP_GENERIC_KERNEL builds only the one reading N at run time */
+#ifdef WSP_GENERIC_KERNEL
+#define KERNEL_SIZES(X)
+#else
+#define KERNEL_SIZES(X) \
+    X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13) \
+    X(14) X(15) X(16) X(17) X(18) X(19) X(20) X(21) X(22) X(23) \
+    X(24) X(25) X(26) X(27) X(28) X(29) X(30) X(31) X(32) X(33) \
+    X(34) X(35) X(36) X(37) X(38) X(39) X(40) X(41) X(42) X(43) \
+    X(44) X(45) X(46) X(47) X(48) X(49) X(50) X(51) X(52) X(53) \
+    X(54) X(55) X(56) X(57) X(58) X(59) X(60) X(61) X(62) X(63) \
+    X(64)
+#endif
+
+enum { TAG_STEAL_REQ = 20, TAG_STEAL_REPLY, TAG_TOKEN, TAG_DONE, TAG_TT, TAG_TRACE };
+enum { WHITE = 0, BLACK = 1 };
+
+typedef uint64_t mask_t;
+
+/* Tour prefix, one byte per city */
+typedef struct {
+    uint8_t city[MAX_PATH];
+} Path;
 
 typedef struct {
     int depth;
     int cost;
     int city;
-    int visitedMask;
-    int path[MAX_PATH];
+    mask_t visitedMask;
+    Path path;
 } Task;
 
+/* Per-rank pool of seed tasks, claimed in order by the OpenMP threads */
+typedef struct {
+    Task *tasks;
+    int count;
+    int next;               /* first unclaimed task */
+} TaskPool;
+
+enum { ENGINE_BB = 0, ENGINE_HK };
+enum { BOUND_2EDGE = 0, BOUND_1TREE };
+enum { TT_DEPTH = 0, TT_ALWAYS };
+enum { FORMAT_TEXT = 0, FORMAT_BINARY, FORMAT_COORDS };
+
+/* Binary instance (input/dist2bin): this header, then N*N native int32
+ * distances in row-major order */
+typedef struct {
+    char magic[4];          /* "WSPB" */
+    uint32_t version;       /* 1 */
+    uint32_t n;
+    uint32_t reserved;
+} BinaryHeader;
+
+/* Command-line tunables */
+typedef struct {
+    int engine;             /* ENGINE_BB (branch and bound) or ENGINE_HK  */
+    int bound;              /* BOUND_2EDGE or BOUND_1TREE                 */
+    int bound_depth;        /* 1-tree bound down to this depth (-1 = auto) */
+    int no_warm_start;      /* skip the heuristic incumbent               */
+    int tt_mb;              /* dominance table budget per rank (0 = off)  */
+    int tt_policy;          /* TT_DEPTH or TT_ALWAYS replacement          */
+    int tt_merge;           /* gossip entries around the rank ring        */
+    int suffix_k;           /* suffix table levels (-1 = auto, 0 = off)   */
+    int no_symmetry;        /* search both orientations even if symmetric */
+    int seed_depth;         /* expand prefixes to this depth (0 = auto) */
+    int seed_tasks;         /* ... or until this many exist (0 = auto)  */
+    int probes;             /* Knuth probes per seed (0 = deal round-robin) */
+    int best_first_mb;      /* best-first heap budget per rank (0 = off) */
+    int numa;               /* share instance data per NUMA domain, not node */
+    const char *profile;    /* tuned settings to start from (NULL = none) */
+    const char *tune;       /* probe configurations, save winner here */
+    double tune_budget;     /* time limit per probe */
+    const char *batch;      /* manifest of instances (NULL = one file)  */
+    const char *checkpoint; /* checkpoint file prefix (NULL = off)      */
+    int checkpoint_interval;/* seconds between checkpoints              */
+    int restart;            /* resume from the checkpoint files         */
+    const char *stats;      /* JSON report file, "-" = stdout (NULL = off) */
+    const char *trace;      /* Chrome trace file (NULL = off)           */
+    double time_limit;      /* stop after this many seconds (0 = off)   */
+    double gap;             /* stop within this % of the root bound (< 0 = off) */
+} Options;
+
+static Options opts = { .bound_depth = -1, .suffix_k = -1,
+                        .checkpoint_interval = CHECKPOINT_INTERVAL, .gap = -1,
+                        .tune_budget = TUNE_BUDGET };
+
 /* Enhanced bound precomputation */
 typedef struct {
     int cheapest1[MAX_N];   /* Cheapest edge from each city */
     int cheapest2[MAX_N];   /* Second cheapest edge from each city */
+    int cheapest_in[MAX_N]; /* Cheapest edge into each city */
+    int directed;           /* some d(i,j) != d(j,i) */
+    _Alignas(64) int half[MAX_N];     /* Per-city share of any path through it, zero-padded */
+    _Alignas(64) int to_zero[MAX_N];  /* DIST(j, 0), the closing edge */
+    uint8_t neighbours[MAX_N][MAX_N - 1];  /* Other cities, nearest first */
+    uint8_t neighbour_rank[MAX_N][MAX_N];  /* Position of j in neighbours[i] */
 } BoundInfo;
 
 /* Global state */
+static MPI_Comm comm;                  /* ranks solving the current instance */
+static int  quiet;                     /* batch mode: no per-instance chatter */
 static int  N;
-static int  dist[MAX_N][MAX_N];
-static int  best_cost;
+static int *dist;                      /* N rows of dist_stride ints, node-shared */
+static int  dist_stride;
+static mask_t all_cities;              /* bits 0..N-1 */
+
+#define DIST(i, j) dist[(i) * dist_stride + (j)]
+#define STRIDE_OF(n) (((n) + DIST_ALIGN - 1) / DIST_ALIGN * DIST_ALIGN)
+#define CITIES_OF(n) ((n) == 64 ? ~(mask_t)0 : ((mask_t)1 << (n)) - 1)
+
+/* Hot functions take `const int N`, shadowing the global, and open with
+ * KERNEL_GEOMETRY to shadow the stride and city mask as well.  Inlined
+ * into a kernel instantiated for one city count, every N, DIST() and
+ * all_cities in them is then a compile-time constant. */
+#define KERNEL_GEOMETRY \
+    const int dist_stride = STRIDE_OF(N); \
+    const mask_t all_cities = CITIES_OF(N); \
+    (void)dist_stride; (void)all_cities
+static int *best_cost;                 /* pruning bound, shared by the node's ranks */
 static int  best_path[MAX_PATH + 1];
-static BoundInfo bounds;
+static int  best_path_cost;            /* cost of the tour in best_path */
+static int  symmetric;                 /* only tours with path[1] < path[N-1] */
+static BoundInfo *bounds;              /* node-shared, like dist */
 
+/* Hot part of a DFS node - everything the pop/prune/expand loop reads.
+ * The prefix lives in a parallel Path array and is only touched when a
+ * node is expanded or completes a tour. */
 typedef struct {
-    int city, depth, cost, visitedMask;
-    int path[MAX_PATH];
-    int parent_lb;  /* Incremental lower bound */
+    int cost;
+    int parent_lb;          /* Incremental lower bound */
+    mask_t visitedMask;
+    int bound;              /* Strongest bound known, pruned against */
+    uint8_t city, depth;
+    uint8_t first;          /* path[1], for symmetry breaking */
 } Node;
 
-/* Precompute enhanced bounds */
+/* Search counters.  Each thread counts into its own copy, merged into
+ * `stats` when the DFS ends; -DWSP_NO_STATS compiles them all out. */
+#ifdef WSP_NO_STATS
+#define STAT(x)
+#else
+#define STAT(x) x
+#endif
+
+typedef struct {
+    uint64_t expanded;      /* nodes whose children were generated */
+    uint64_t pruned_cost;   /* popped with cost >= incumbent */
+    uint64_t pruned_bound;  /* popped with parent_lb/1-tree bound >= incumbent */
+    uint64_t pruned_child;  /* children cut before they were pushed */
+    uint64_t pruned_closing;/* full tours no better once closed */
+    uint64_t dominated;     /* cut by the dominance table */
+    uint64_t suffix;        /* finished from the suffix table */
+    uint64_t spilled;       /* children sent to the overflow pool */
+    uint64_t high_water;    /* deepest any deque got */
+} SearchStats;
+
+#define STATS_FIELDS (sizeof(SearchStats) / sizeof(uint64_t))
+
+typedef struct {
+    SearchStats total;      /* this rank, all threads */
+    uint64_t thread_min, thread_max;    /* nodes expanded by one thread */
+    double t0;              /* search start */
+    double first_tour;      /* first and last improvement of best_path, */
+    double best_tour;       /* relative to t0 (< 0 = none yet)          */
+} RankStats;
+
+static RankStats stats;
+
+static double wall_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+/* Event trace (--trace).  Each thread records spans and instants into
+ * its own ring of TRACE_EVENTS slots, allocated before the search, so
+ * recording never allocates or locks; a full ring overwrites its oldest
+ * events.  Afterwards rank 0 collects every ring and writes one Chrome
+ * trace (chrome://tracing, ui.perfetto.dev): a process per rank, a track
+ * per thread.  Times are relative to each rank's own search start, which
+ * follows the collective instance setup.  -DWSP_NO_TRACE compiles the
+ * hooks out. */
+#ifdef WSP_NO_TRACE
+#define TRACE(x)
+#else
+#define TRACE(x) x
+#endif
+
+enum {
+    TR_TASK,                /* span: a seed or stolen node searched to exhaustion */
+    TR_FIND_WORK,           /* span: thread idle, looking for work */
+    TR_STEAL,               /* instant: steal attempt on a sibling deque */
+    TR_STEAL_REMOTE,        /* span: steal request to another rank until its reply */
+    TR_SERVE,               /* instant: steal request answered */
+    TR_INCUMBENT,           /* instant: best_path improved */
+    TR_EXCHANGE,            /* span: incumbent window exchange in flight */
+    TR_GATHER,              /* span: final collection of the best tour */
+    TRACE_KINDS
+};
+
+typedef struct {
+    double start, dur;      /* seconds since trace.t0; dur < 0 = instant */
+    int kind, arg, peer;    /* arguments named per kind in trace_write */
+    int thread;
+} TraceEvent;
+
+typedef struct {
+    _Alignas(64) TraceEvent *events;
+    uint64_t count;         /* events ever recorded */
+} TraceRing;
+
+typedef struct {
+    TraceRing *rings;       /* one per thread; NULL = tracing off */
+    int threads;
+    double t0;
+    double exchange_start;  /* TR_EXCHANGE issue time (master thread) */
+    double steal_start;     /* TR_STEAL_REMOTE send time (master thread) */
+    int steal_victim;
+} TraceState;
+
+static TraceState trace;
+
+static inline double trace_now(void)
+{
+    return wall_time() - trace.t0;
+}
+
+/* Record an event of `kind` starting at `start` on the calling thread */
+static inline void trace_event(int kind, double start, double dur, int arg, int peer)
+{
+    if (!trace.rings) return;
+    #ifdef _OPENMP
+    int t = omp_get_thread_num();
+    #else
+    int t = 0;
+    #endif
+    if (t >= trace.threads) return;
+
+    TraceRing *r = &trace.rings[t];
+    r->events[r->count++ % TRACE_EVENTS] =
+        (TraceEvent){ start, dur, kind, arg, peer, t };
+}
+
+static inline void trace_span(int kind, double start, int arg, int peer)
+{
+    if (trace.rings) trace_event(kind, start, trace_now() - start, arg, peer);
+}
+
+static inline void trace_instant(int kind, int arg, int peer)
+{
+    if (trace.rings) trace_event(kind, trace_now(), -1, arg, peer);
+}
+
+/* Any thread, right after it improves best_path (inside the critical) */
+static inline void stats_tour(void)
+{
+    STAT(
+        double t = wall_time() - stats.t0;
+        if (stats.first_tour < 0) stats.first_tour = t;
+        stats.best_tour = t;
+    )
+    TRACE(trace_instant(TR_INCUMBENT, best_path_cost, -1);)
+}
+
+/* Anytime mode (--time-limit, --gap).  Rank 0 prints every improvement
+ * of the incumbent it learns of.  Once a rank's master sees the deadline
+ * pass or the incumbent come within the gap, its threads drop every node
+ * they pop instead of expanding it.  The rank then goes idle, steals and
+ * drops its peers' work too, and the usual termination detection ends
+ * the search.  The least bound among dropped nodes is what the run still
+ * proves. */
+enum { STOP_NONE = 0, STOP_TIME, STOP_GAP };
+
+typedef struct {
+    int active;
+    double t0, deadline;    /* wall_time(); deadline 0 = none */
+    int root_bound;         /* the gap is measured against this */
+    int reported;           /* last incumbent streamed (rank 0) */
+    int rank;
+    atomic_int stop;        /* STOP_* */
+    int floor;              /* least bound of a dropped node */
+} AnytimeState;
+
+static AnytimeState anytime;
+
+/* Reply to a steal request: count == 0 means "no work to spare" */
+typedef struct {
+    int count;
+    Task tasks[STEAL_CHUNK];
+} StealMsg;
+
+/* Inter-rank work-stealing state.  Only the master thread touches it.
+ * Termination uses Safra's token algorithm: `counter` is work messages
+ * sent minus received, a rank turns BLACK when it receives work, and
+ * the white token circulates 0 -> 1 -> ... -> world-1 -> 0 while ranks
+ * are idle.  Rank 0 starts each probe itself and judges only a token that
+ * has come back (`probing`).  Steal requests and empty replies are control
+ * messages and are not counted. */
+typedef struct {
+    int rank, world;
+    int counter;
+    int color;
+    int have_token, token_color, token_count;
+    int probing;            /* rank 0: a probe went round the ring */
+    int pending;            /* outstanding steal request */
+    int done;
+    unsigned seed;
+} StealState;
+
+static StealState steal;
+
+/* Global incumbent: one int on the first node leader, combined with
+ * MPI_MIN through MPI_Rget_accumulate, which publishes the node's best
+ * and fetches the old global value in a single non-blocking call.
+ * Master thread of node leaders only. */
+typedef struct {
+    MPI_Win win;
+    int *value;             /* window memory (rank 0 only) */
+    MPI_Request req;
+    int sent, fetched;      /* must stay untouched while req is active */
+} IncumbentState;
+
+static IncumbentState incumbent = { .win = MPI_WIN_NULL, .req = MPI_REQUEST_NULL };
+
+/* --------------------------------------------------------------------
+ *  Node sharing: the ranks of `comm` that share memory split off a node
+ *  communicator, and the read-only instance data (matrix, bound tables,
+ *  suffix table) lives once per node in MPI-3 shared windows allocated
+ *  on the node leader.  The pruning incumbent sits in the same window
+ *  and is lowered with a CAS by every thread of every rank on the node,
+ *  so only the leaders take part in the inter-node MPI_MIN exchange.
+ * --------------------------------------------------------------------*/
+typedef struct {
+    MPI_Comm comm;          /* ranks of `comm` on this node */
+    MPI_Comm leaders;       /* node rank 0 of every node, else MPI_COMM_NULL */
+    int rank, size;         /* within node.comm */
+    int nodes;              /* size of leaders */
+    MPI_Win win;            /* incumbent, bounds and matrix of this solve */
+} NodeShare;
+
+static NodeShare node = { .comm = MPI_COMM_NULL, .leaders = MPI_COMM_NULL,
+                          .win = MPI_WIN_NULL };
+
+/* Head of node.win; the matrix follows at the next cache line */
+typedef struct {
+    _Alignas(64) int incumbent;     /* alone on its line: hot for writes */
+    BoundInfo bounds;
+} NodeInstance;
+
+/* Collective over comm */
+static void node_init(void)
+{
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    /* With --numa, the ranks of each NUMA domain keep their own replica */
+    int type = MPI_COMM_TYPE_SHARED;
+    #ifdef OPEN_MPI
+    if (opts.numa) type = OMPI_COMM_TYPE_NUMA;
+    #else
+    if (opts.numa && rank == 0 && !quiet)
+        fprintf(stderr, "--numa needs Open MPI; sharing per node\n");
+    #endif
+    MPI_Comm_split_type(comm, type, rank, MPI_INFO_NULL, &node.comm);
+    MPI_Comm_rank(node.comm, &node.rank);
+    MPI_Comm_size(node.comm, &node.size);
+
+    MPI_Comm_split(comm, node.rank == 0 ? 0 : MPI_UNDEFINED, rank, &node.leaders);
+    if (node.leaders != MPI_COMM_NULL) MPI_Comm_size(node.leaders, &node.nodes);
+    MPI_Bcast(&node.nodes, 1, MPI_INT, 0, node.comm);
+}
+
+static void node_free(void)
+{
+    if (node.leaders != MPI_COMM_NULL) MPI_Comm_free(&node.leaders);
+    if (node.comm != MPI_COMM_NULL) MPI_Comm_free(&node.comm);
+}
+
+/* Ask for transparent hugepages on the whole 2 MB pages inside [p, p+bytes).
+ * Advisory: kernels without THP, or with it off for shared memory, just
+ * keep 4 KB pages. */
+static void huge_advise(void *p, size_t bytes)
+{
+    #ifdef MADV_HUGEPAGE
+    uintptr_t lo = ((uintptr_t)p + HUGE_PAGE - 1) & ~(uintptr_t)(HUGE_PAGE - 1);
+    uintptr_t hi = ((uintptr_t)p + bytes) & ~(uintptr_t)(HUGE_PAGE - 1);
+    if (hi > lo) madvise((void *)lo, hi - lo, MADV_HUGEPAGE);
+    #else
+    (void)p; (void)bytes;
+    #endif
+}
+
+/* aligned_alloc for tables: 2 MB-aligned and hugepage-advised from 2 MB
+ * up, cache-line aligned below.  Pages are placed by the first thread to
+ * touch them, so callers initialise from the threads that will use them. */
+static void *huge_alloc(size_t bytes)
+{
+    size_t align = bytes >= HUGE_PAGE ? HUGE_PAGE : 64;
+    size_t size = (bytes + align - 1) / align * align;
+    void *p = aligned_alloc(align, size ? size : align);
+    if (p && align == HUGE_PAGE) huge_advise(p, size);
+    return p;
+}
+
+/* `bytes` of memory shared by the node, held by the node leader and
+ * aligned to a cache line.  Opens a lock_all epoch so node_sync can
+ * order the leader's writes before the other ranks' reads. */
+static void *node_alloc(size_t bytes, MPI_Win *win)
+{
+    char *base;
+    MPI_Aint size;
+    int disp;
+
+    /* Segments are page-aligned, so the rounding agrees across ranks */
+    if (MPI_Win_allocate_shared(node.rank == 0 ? (MPI_Aint)bytes + 64 : 0, 1,
+                                MPI_INFO_NULL, node.comm, &base, win) != MPI_SUCCESS) {
+        fprintf(stderr, "cannot allocate %.1f MB of node-shared memory\n",
+                bytes / 1048576.0);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Win_shared_query(*win, 0, &size, &disp, &base);
+    if (node.rank == 0) huge_advise(base, size);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, *win);
+    return base + (-(uintptr_t)base & 63);
+}
+
+/* After the writers' part, before anyone reads.  Collective over node.comm. */
+static void node_sync(MPI_Win win)
+{
+    MPI_Win_sync(win);
+    MPI_Barrier(node.comm);
+    MPI_Win_sync(win);
+}
+
+static void node_release(MPI_Win *win)
+{
+    if (*win == MPI_WIN_NULL) return;
+    MPI_Win_unlock_all(*win);
+    MPI_Win_free(win);
+}
+
+/* Lower the node's incumbent to `cost`; nonzero if this call did it */
+static inline int incumbent_lower(int cost)
+{
+    int current = __atomic_load_n(best_cost, __ATOMIC_RELAXED);
+    while (cost < current) {
+        if (__atomic_compare_exchange_n(best_cost, &current, cost, 0,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            return 1;
+    }
+    return 0;
+}
+
+/* Precompute enhanced bounds.  The rest of a tour enters and leaves
+ * every unvisited city once.  On a symmetric matrix those are two
+ * distinct edges at the city, so half its two cheapest edges is a lower
+ * bound on its share; on an asymmetric one the edge in comes from the
+ * city's column, so the share is half its cheapest edges out and in. */
 static void precompute_enhanced_bounds(void)
 {
+    bounds->directed = 0;
+    for (int j = 0; j < N; j++) {
+        int min_in = INT_MAX;
+        for (int i = 0; i < N; i++) {
+            if (i == j) continue;
+            if (DIST(i, j) < min_in) min_in = DIST(i, j);
+            if (DIST(i, j) != DIST(j, i)) bounds->directed = 1;
+        }
+        bounds->cheapest_in[j] = (min_in == INT_MAX) ? 0 : min_in;
+    }
+
     for (int i = 0; i < N; i++) {
         int min1 = INT_MAX, min2 = INT_MAX;
         
         for (int j = 0; j < N; j++) {
             if (i == j) continue;
             
-            if (dist[i][j] < min1) {
+            if (DIST(i, j) < min1) {
                 min2 = min1;
-                min1 = dist[i][j];
-            } else if (dist[i][j] < min2) {
-                min2 = dist[i][j];
+                min1 = DIST(i, j);
+            } else if (DIST(i, j) < min2) {
+                min2 = DIST(i, j);
             }
         }
         
-        bounds.cheapest1[i] = (min1 == INT_MAX) ? 0 : min1;
-        bounds.cheapest2[i] = (min2 == INT_MAX) ? 0 : min2;
+        bounds->cheapest1[i] = (min1 == INT_MAX) ? 0 : min1;
+        bounds->cheapest2[i] = (min2 == INT_MAX) ? 0 : min2;
+        bounds->half[i] = (bounds->cheapest1[i] + (bounds->directed ? bounds->cheapest_in[i]
+                                                                    : bounds->cheapest2[i])) / 2;
+        bounds->to_zero[i] = DIST(i, 0);
+
+        /* Branch order for children of i: insertion sort by distance */
+        uint8_t *nb = bounds->neighbours[i];
+        int count = 0;
+        for (int j = 0; j < N; j++) {
+            if (j == i) continue;
+            int k = count++;
+            while (k > 0 && DIST(i, nb[k - 1]) > DIST(i, j)) {
+                nb[k] = nb[k - 1];
+                k--;
+            }
+            nb[k] = (uint8_t)j;
+        }
+        for (int k = 0; k < N - 1; k++) bounds->neighbour_rank[i][nb[k]] = (uint8_t)k;
     }
 }
 
 /* Enhanced 2-edge lower bound */
-static inline int lower_bound_2edge(int cost, int mask)
+static inline int lower_bound_2edge(int cost, mask_t mask)
 {
     int lb = cost;
     
     /* Bit-scan for unvisited cities */
-    int unvisited = (~mask) & ((1 << N) - 1);
+    mask_t unvisited = ~mask & all_cities;
     while (unvisited) {
-        int i = __builtin_ctz(unvisited);  /* Count trailing zeros */
-        lb += (bounds.cheapest1[i] + bounds.cheapest2[i]) / 2;
+        int i = __builtin_ctzll(unvisited);  /* Count trailing zeros */
+        lb += bounds->half[i];
         unvisited &= unvisited - 1;  /* Clear lowest set bit */
     }
     
@@ -89,271 +610,3005 @@ static inline int lower_bound_2edge(int cost, int mask)
 }
 
 /* Incremental lower bound update */
-static inline int incremental_lower_bound(int parent_lb, int prev_city, int cur_city)
+static inline int incremental_lower_bound(int parent_lb, int prev_city, int cur_city,
+                                          const int N)
 {
-    return parent_lb + dist[prev_city][cur_city] - 
-           (bounds.cheapest1[cur_city] + bounds.cheapest2[cur_city]) / 2;
+    KERNEL_GEOMETRY;
+    return parent_lb + DIST(prev_city, cur_city) - bounds->half[cur_city];
 }
 
-/* Simplified hybrid DFS worker - no complex work-stealing */
-static void stable_hybrid_dfs(Task *initial_tasks, int num_tasks)
+/* Under symmetry breaking a tour is kept only if its last city exceeds
+ * path[1].  True if a node can still end that way: some unvisited city
+ * is larger than `first`, or none is left and the node's own city is. */
+static inline int orientation_ok(mask_t visited, int city, int first)
 {
-    if (num_tasks == 0) return;
+    mask_t unvisited = ~visited & all_cities;
+    return unvisited ? 63 - __builtin_clzll(unvisited) > first : city > first;
+}
 
-#ifdef _OPENMP
-    #pragma omp parallel shared(best_cost, best_path)
-    {
-        int thread_id = omp_get_thread_num();
-        int num_threads = omp_get_num_threads();
+/* Children of n that survive the cost, 2-edge and closing-edge tests
+ * against best, as a mask over cities.  The vector paths read whole
+ * padded rows: dist_stride and the bound arrays are multiples of 16 ints
+ * and 64-byte aligned, and padding lanes are masked off at the end. */
+static inline mask_t surviving_children(const Node *n, int best, const int N)
+{
+    KERNEL_GEOMETRY;
+    const int *row = &DIST(n->city, 0);
+    const int closing = n->depth == N - 1;
+    mask_t live = 0;
+
+#if defined(__AVX512F__)
+    const __m512i vbest = _mm512_set1_epi32(best);
+    const __m512i vcost = _mm512_set1_epi32(n->cost);
+    const __m512i vlb = _mm512_set1_epi32(n->parent_lb);
+    for (int j = 0; j < N; j += 16) {
+        __m512i d = _mm512_load_si512((const void *)(row + j));
+        __m512i cost = _mm512_add_epi32(vcost, d);
+        __m512i lb = _mm512_sub_epi32(_mm512_add_epi32(vlb, d),
+                                      _mm512_load_si512((const void *)(bounds->half + j)));
+        __mmask16 k = _mm512_cmplt_epi32_mask(cost, vbest) & _mm512_cmplt_epi32_mask(lb, vbest);
+        if (closing) {
+            __m512i tour = _mm512_add_epi32(cost, _mm512_load_si512((const void *)(bounds->to_zero + j)));
+            k &= _mm512_cmplt_epi32_mask(tour, vbest);
+        }
+        live |= (mask_t)k << j;
+    }
+#elif defined(__AVX2__)
+    const __m256i vbest = _mm256_set1_epi32(best);
+    const __m256i vcost = _mm256_set1_epi32(n->cost);
+    const __m256i vlb = _mm256_set1_epi32(n->parent_lb);
+    for (int j = 0; j < N; j += 8) {
+        __m256i d = _mm256_load_si256((const __m256i *)(row + j));
+        __m256i cost = _mm256_add_epi32(vcost, d);
+        __m256i lb = _mm256_sub_epi32(_mm256_add_epi32(vlb, d),
+                                      _mm256_load_si256((const __m256i *)(bounds->half + j)));
+        __m256i ok = _mm256_and_si256(_mm256_cmpgt_epi32(vbest, cost), _mm256_cmpgt_epi32(vbest, lb));
+        if (closing) {
+            __m256i tour = _mm256_add_epi32(cost, _mm256_load_si256((const __m256i *)(bounds->to_zero + j)));
+            ok = _mm256_and_si256(ok, _mm256_cmpgt_epi32(vbest, tour));
+        }
+        live |= (mask_t)(unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(ok)) << j;
+    }
 #else
-        int thread_id = 0;
-        int num_threads = 1;
+    for (mask_t m = ~n->visitedMask & all_cities; m; m &= m - 1) {
+        int j = __builtin_ctzll(m);
+        int cost = n->cost + row[j];
+        if (cost < best && n->parent_lb + row[j] - bounds->half[j] < best &&
+            (!closing || cost + bounds->to_zero[j] < best))
+            live |= (mask_t)1 << j;
+    }
 #endif
-        
-        /* Per-thread stack */
-        Node *stack = malloc(MAX_STACK_SIZE * sizeof(Node));
-        if (!stack) { perror("malloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
-        
-        int sp = 0;
-        
-        /* Each thread gets a portion of initial tasks */
-        int tasks_per_thread = (num_tasks + num_threads - 1) / num_threads;
-        int thread_start = thread_id * tasks_per_thread;
-        int thread_end = thread_start + tasks_per_thread;
-        if (thread_end > num_tasks) thread_end = num_tasks;
-        
-        /* Convert assigned tasks to stack nodes */
-        for (int t = thread_start; t < thread_end; t++) {
-            const Task *task = &initial_tasks[t];
-            stack[sp] = (Node){ 
-                .city = task->city, 
-                .depth = task->depth, 
-                .cost = task->cost,
-                .visitedMask = task->visitedMask,
-                .parent_lb = lower_bound_2edge(task->cost, task->visitedMask)
-            };
-            memcpy(stack[sp].path, task->path, task->depth * sizeof(int));
-            sp++;
-        }
 
-        /* Main DFS loop */
-        while (sp > 0) {
-            Node n = stack[--sp];
+    live &= ~n->visitedMask & all_cities;
 
-            /* Get current best cost (thread-safe read) */
-            int current_best;
-            #ifdef _OPENMP
-            #pragma omp atomic read
-            #endif
-            current_best = best_cost;
+    /* Every child but the largest unvisited city leaves that city to be
+     * last; the largest itself is fine only if the next one still
+     * exceeds path[1] (or it is the final city) */
+    if (symmetric && n->depth >= 2 && live) {
+        mask_t unvisited = ~n->visitedMask & all_cities;
+        mask_t top = (mask_t)1 << (63 - __builtin_clzll(unvisited));
+        mask_t rest = unvisited & ~top;
+        if (63 - __builtin_clzll(rest ? rest : top) < n->first) live &= ~top;
+    }
+    return live;
+}
 
-            /* Enhanced pruning */
-            if (n.cost >= current_best || n.parent_lb >= current_best) {
-                continue;
-            }
+/* --------------------------------------------------------------------
+ *  Lagrangian 1-tree bound.  The rest of a tour - from the current city
+ *  c through the unvisited set U and back to 0 - costs at least
+ *      min_u (d(c,u) + pi_u) + MST'(U) + min_u (d(u,0) + pi_u) - 2 sum_U pi
+ *  for any node penalties pi, where MST' spans U under
+ *  w(i,j) = min(d(i,j), d(j,i)) + pi_i + pi_j.  The penalties are tuned
+ *  once at the root by subgradient ascent on the Held-Karp 1-tree and
+ *  reused unchanged by every node that is shallow enough to afford the
+ *  O(|U|^2) spanning tree.
+ * --------------------------------------------------------------------*/
+typedef struct {
+    int pi[MAX_N];          /* Rounded root penalties */
+    int *w;                 /* Penalised symmetric weights, dist_stride per row */
+    int depth;              /* Effective --bound-depth (0 = 2-edge only) */
+} OneTree;
 
-            /* Complete tour check */
-            if (n.depth == N) {
-                int tour_cost = n.cost + dist[n.city][0];
-                if (tour_cost < current_best) {
-                    #ifdef _OPENMP
-                    #pragma omp critical
-                    #endif
-                    {
-                        if (tour_cost < best_cost) {
-                            best_cost = tour_cost;
-                            memcpy(best_path, n.path, N * sizeof(int));
-                            best_path[N] = 0;
-                        }
-                    }
-                }
-                continue;
-            }
+static OneTree onetree;
+#define W1T(i, j) onetree.w[(i) * dist_stride + (j)]
 
-            /* Expand children with branch ordering */
-            int children[MAX_N];
-            int child_count = 0;
-            
-            /* Collect unvisited cities using bit operations */
-            int unvisited = (~n.visitedMask) & ((1 << N) - 1);
-            while (unvisited) {
-                int city = __builtin_ctz(unvisited);
-                children[child_count++] = city;
-                unvisited &= unvisited - 1;
-            }
-            
-            /* Sort children by distance for better branch ordering */
-            for (int i = 0; i < child_count - 1; i++) {
-                for (int j = i + 1; j < child_count; j++) {
-                    if (dist[n.city][children[i]] > dist[n.city][children[j]]) {
-                        int temp = children[i];
-                        children[i] = children[j];
-                        children[j] = temp;
-                    }
-                }
-            }
-            
-            /* Add children in reverse order (stack is LIFO) */
-            for (int c = child_count - 1; c >= 0; c--) {
-                int next = children[c];
-                int new_cost = n.cost + dist[n.city][next];
-                
-                if (new_cost >= current_best) continue;
-                
-                int new_lb = incremental_lower_bound(n.parent_lb, n.city, next);
-                if (new_lb >= current_best) continue;
-                
-                if (n.depth == N - 1) {
-                    int final_cost = new_cost + dist[next][0];
-                    if (final_cost >= current_best) continue;
-                }
-                
-                if (sp >= MAX_STACK_SIZE - 1) continue;
-                
-                stack[sp] = n;
-                stack[sp].city = next;
-                stack[sp].cost = new_cost;
-                stack[sp].visitedMask |= (1 << next);
-                stack[sp].path[n.depth] = next;
-                stack[sp].depth = n.depth + 1;
-                stack[sp].parent_lb = new_lb;
-                sp++;
-            }
+static inline int sym_dist(int i, int j)
+{
+    return DIST(i, j) < DIST(j, i) ? DIST(i, j) : DIST(j, i);
+}
+
+/* Minimum 1-tree under real penalties: a spanning tree over 1..N-1 plus
+ * the two cheapest edges at city 0.  Returns its penalised weight and
+ * the degree of every city. */
+static double root_onetree(const double *pi, int *deg)
+{
+    double key[MAX_N], total = 0.0;
+    int from[MAX_N], done[MAX_N] = {0};
+
+    for (int i = 0; i < N; i++) { key[i] = 1e300; from[i] = -1; deg[i] = 0; }
+    key[1] = 0.0;
+
+    for (int it = 1; it < N; it++) {
+        int u = -1;
+        for (int v = 1; v < N; v++)
+            if (!done[v] && (u < 0 || key[v] < key[u])) u = v;
+        done[u] = 1;
+        if (from[u] >= 0) {
+            total += key[u];
+            deg[u]++;
+            deg[from[u]]++;
         }
-        
-        free(stack);
+        for (int v = 1; v < N; v++) {
+            double w = sym_dist(u, v) + pi[u] + pi[v];
+            if (!done[v] && w < key[v]) { key[v] = w; from[v] = u; }
+        }
+    }
 
-#ifdef _OPENMP
-    } /* End parallel region */
-#endif
+    int a = -1, b = -1;
+    for (int v = 1; v < N; v++) {
+        double w = sym_dist(0, v) + pi[v];
+        if (a < 0 || w < sym_dist(0, a) + pi[a]) { b = a; a = v; }
+        else if (b < 0 || w < sym_dist(0, b) + pi[b]) b = v;
+    }
+    total += sym_dist(0, a) + sym_dist(0, b) + pi[a] + pi[b] + 2.0 * pi[0];
+    deg[0] = 2;
+    deg[a]++;
+    deg[b]++;
+    return total;
 }
 
-/* Stable distributed search */
-static void stable_distributed_search(int rank, int world)
+/* Cost of the nearest-neighbour tour, the ascent's step-size target */
+static int nearest_neighbour_cost(void)
 {
-    Task my_tasks[MAX_N];
-    int my_task_count = 0;
-    
-    /* Work distribution */
-    int total_tasks = N - 1;
-    int base_tasks = total_tasks / world;
-    int extra_tasks = total_tasks % world;
-    
-    int my_start = rank * base_tasks + (rank < extra_tasks ? rank : extra_tasks);
-    int my_end = my_start + base_tasks + (rank < extra_tasks ? 1 : 0);
-    
-    /* Create initial tasks for this rank */
-    for (int i = my_start; i < my_end; i++) {
-        int city = i + 1;
-        my_tasks[my_task_count] = (Task){
-            .depth = 2,
-            .cost = dist[0][city],
-            .city = city,
-            .visitedMask = (1 << 0) | (1 << city),
-            .path = {0}
-        };
-        my_tasks[my_task_count].path[0] = 0;
-        my_tasks[my_task_count].path[1] = city;
-        my_task_count++;
-    }
-    
-    if (rank == 0) {
-        printf("Stable hybrid search: %d ranks, %d-%d tasks per rank", 
-               world, base_tasks, base_tasks + 1);
-        #ifdef _OPENMP
-        printf(", %d OpenMP threads per rank\n", omp_get_max_threads());
-        #else
-        printf(", 1 thread per rank\n");
-        #endif
+    mask_t left = all_cities & ~(mask_t)1;
+    int city = 0, cost = 0;
+    while (left) {
+        int next = -1;
+        for (mask_t m = left; m; m &= m - 1) {
+            int c = __builtin_ctzll(m);
+            if (next < 0 || DIST(city, c) < DIST(city, next)) next = c;
+        }
+        cost += DIST(city, next);
+        city = next;
+        left &= ~((mask_t)1 << next);
     }
-    
-    /* Run stable hybrid DFS */
-    stable_hybrid_dfs(my_tasks, my_task_count);
+    return cost + DIST(city, 0);
 }
 
-static void read_distance_file(const char *fname)
+/* Bound for a node standing at city c with the given visited mask */
+static int onetree_bound(int cost, int c, mask_t mask)
 {
-    FILE *fp = fopen(fname, "r");
-    if (!fp) { perror("open dist file"); MPI_Abort(MPI_COMM_WORLD, 1); }
+    mask_t unvisited = ~mask & all_cities;
+    if (!unvisited) return cost + DIST(c, 0);
 
-    if (fscanf(fp, "%d", &N) != 1 || N > MAX_N || N <= 0) {
-        fprintf(stderr, "Invalid N=%d in file (must be 1-%d)\n", N, MAX_N);
-        MPI_Abort(MPI_COMM_WORLD, 1);
+    int member[MAX_N], key[MAX_N];
+    int k = 0, pisum = 0, head = INT_MAX, tail = INT_MAX;
+    while (unvisited) {
+        int u = __builtin_ctzll(unvisited);
+        unvisited &= unvisited - 1;
+        member[k++] = u;
+        pisum += onetree.pi[u];
+        if (DIST(c, u) + onetree.pi[u] < head) head = DIST(c, u) + onetree.pi[u];
+        if (DIST(u, 0) + onetree.pi[u] < tail) tail = DIST(u, 0) + onetree.pi[u];
     }
 
-    memset(dist, 0, sizeof(dist));
+    /* Prim over U; cities still outside the tree are member[1..left] */
+    int mst = 0;
+    for (int i = 1; i < k; i++) key[i] = W1T(member[0], member[i]);
+    for (int left = k - 1; left > 0; left--) {
+        int bi = 1;
+        for (int i = 2; i <= left; i++)
+            if (key[i] < key[bi]) bi = i;
+        mst += key[bi];
+        int u = member[bi];
+        member[bi] = member[left];
+        key[bi] = key[left];
+        for (int i = 1; i < left; i++)
+            if (W1T(u, member[i]) < key[i]) key[i] = W1T(u, member[i]);
+    }
 
-    int nums[MAX_N * MAX_N];
-    int cnt = 0;
-    while (cnt < MAX_N * MAX_N && fscanf(fp, "%d", &nums[cnt]) == 1) ++cnt;
-    fclose(fp);
+    return cost + head + mst + tail - 2 * pisum;
+}
 
-    const int needSquare = N * N;
-    const int needTri = N * (N - 1) / 2;
+/* Strongest bound for a node whose incremental 2-edge bound is lb */
+static inline int node_bound(int lb, int cost, int city, mask_t mask, int depth)
+{
+    if (depth <= onetree.depth) {
+        int t = onetree_bound(cost, city, mask);
+        if (t > lb) return t;
+    }
+    return lb;
+}
 
-    if (cnt == needSquare) {
-        for (int i = 0, k = 0; i < N; ++i)
-            for (int j = 0; j < N; ++j)
-                dist[i][j] = nums[k++];
-    } else if (cnt == needTri) {
-        int k = 0;
-        for (int i = 1; i < N; ++i) {
-            for (int j = 0; j < i; ++j) {
-                dist[i][j] = dist[j][i] = nums[k++];
+/* Tune the penalties; every rank runs the same deterministic ascent */
+static int onetree_init(void)
+{
+    onetree.w = aligned_alloc(64, ((size_t)N * dist_stride * sizeof(int) + 63) / 64 * 64);
+    if (!onetree.w) { perror("aligned_alloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+
+    double pi[MAX_N] = {0}, best_pi[MAX_N] = {0};
+    int deg[MAX_N];
+
+    if (N >= 3) {
+        double ub = best_path_cost < INT_MAX ? best_path_cost : nearest_neighbour_cost();
+        double lambda = 2.0, best = -1e300;
+        int stall = 0;
+
+        for (int it = 0; it < ONETREE_ITERS && lambda > 1e-4; it++) {
+            double L = root_onetree(pi, deg);
+            for (int i = 0; i < N; i++) L -= 2.0 * pi[i];
+
+            if (L > best + 1e-9) {
+                best = L;
+                memcpy(best_pi, pi, sizeof(pi));
+                stall = 0;
+            } else if (++stall >= 10) {
+                lambda /= 2.0;
+                stall = 0;
             }
+
+            int norm = 0;
+            for (int i = 0; i < N; i++) norm += (deg[i] - 2) * (deg[i] - 2);
+            if (norm == 0 || L >= ub) break;        /* the 1-tree is a tour */
+
+            double t = lambda * (ub - L) / norm;
+            for (int i = 0; i < N; i++) pi[i] += t * (deg[i] - 2);
         }
-    } else {
-        fprintf(stderr, "Unsupported format: %d ints read, need %d (square) or %d (triangular)\n", 
-                cnt, needSquare, needTri);
-        MPI_Abort(MPI_COMM_WORLD, 1);
     }
+
+    for (int i = 0; i < N; i++)
+        onetree.pi[i] = (int)(best_pi[i] < 0 ? best_pi[i] - 0.5 : best_pi[i] + 0.5);
+    for (int i = 0; i < N; i++)
+        for (int j = 0; j < N; j++)
+            W1T(i, j) = sym_dist(i, j) + onetree.pi[i] + onetree.pi[j];
+
+    /* Only the last few levels are left to the 2-edge chain */
+    onetree.depth = opts.bound_depth < 0 ? N - 3 : opts.bound_depth;
+    return N >= 3 ? onetree_bound(0, 0, 1) : 0;
 }
 
-int main(int argc, char **argv)
+/* Collective over node.leaders */
+static void incumbent_init(void)
+{
+    int rank;
+    MPI_Comm_rank(node.leaders, &rank);
+    MPI_Win_allocate(rank == 0 ? sizeof(int) : 0, sizeof(int), MPI_INFO_NULL,
+                     node.leaders, &incumbent.value, &incumbent.win);
+    if (rank == 0) *incumbent.value = INT_MAX;
+    MPI_Barrier(node.leaders);
+    MPI_Win_lock_all(0, incumbent.win);
+}
+
+/* Master thread: stream a better incumbent, then check the stop rules */
+static void anytime_poll(void)
 {
+    if (!anytime.active) return;
+
+    int current;
     #ifdef _OPENMP
-    MPI_Init(&argc, &argv);  /* Simplified MPI init */
-    #else
-    MPI_Init(&argc, &argv);
+    #pragma omp atomic read
     #endif
+    current = *best_cost;
 
-    int rank, world;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &world);
+    if (anytime.rank == 0 && !quiet && current < anytime.reported) {
+        printf("Incumbent: %d at %.3f s\n", current, wall_time() - anytime.t0);
+        fflush(stdout);
+        anytime.reported = current;
+    }
 
-    if (argc != 2) {
-        if (rank == 0)
-            fprintf(stderr, "usage: %s <distance-file>\n", argv[0]);
-        MPI_Finalize(); 
-        return 1;
+    if (atomic_load(&anytime.stop) != STOP_NONE) return;
+    if (anytime.deadline > 0 && wall_time() >= anytime.deadline)
+        atomic_store(&anytime.stop, STOP_TIME);
+    else if (opts.gap >= 0 && current < INT_MAX &&
+             current - anytime.root_bound <= opts.gap / 100.0 * anytime.root_bound)
+        atomic_store(&anytime.stop, STOP_GAP);
+}
+
+/* Batch groups reuse one window for all their instances: once every
+ * leader's last update has landed, the first one puts back INT_MAX */
+static void incumbent_reset(void)
+{
+    if (incumbent.win == MPI_WIN_NULL) return;
+    if (incumbent.req != MPI_REQUEST_NULL)
+        MPI_Wait(&incumbent.req, MPI_STATUS_IGNORE);
+
+    int rank;
+    MPI_Comm_rank(node.leaders, &rank);
+    MPI_Barrier(node.leaders);
+    if (rank == 0) {
+        const int top = INT_MAX;
+        MPI_Accumulate(&top, 1, MPI_INT, 0, 0, 1, MPI_INT, MPI_REPLACE, incumbent.win);
+        MPI_Win_flush(0, incumbent.win);
     }
+    MPI_Barrier(node.leaders);
+}
 
-    if (rank == 0) read_distance_file(argv[1]);
+/* Complete the previous exchange if it has finished, adopting a better
+ * peer bound, then start the next one.  Never blocks. */
+static void poll_incumbent(void)
+{
+    if (incumbent.win == MPI_WIN_NULL) return;
 
-    MPI_Bcast(&N, 1, MPI_INT, 0, MPI_COMM_WORLD);
-    MPI_Bcast(dist, MAX_N * MAX_N, MPI_INT, 0, MPI_COMM_WORLD);
+    if (incumbent.req != MPI_REQUEST_NULL) {
+        int flag;
+        MPI_Test(&incumbent.req, &flag, MPI_STATUS_IGNORE);
+        if (!flag) return;
 
-    /* Enhanced bound precomputation */
-    precompute_enhanced_bounds();
+        incumbent_lower(incumbent.fetched);
+        TRACE(trace_span(TR_EXCHANGE, trace.exchange_start, incumbent.fetched, -1);)
+    }
 
-    best_cost = INT_MAX;
-    memset(best_path, 0, sizeof(best_path));
+    #ifdef _OPENMP
+    #pragma omp atomic read
+    #endif
+    incumbent.sent = *best_cost;
 
-    double t0 = MPI_Wtime();
+    TRACE(if (trace.rings) trace.exchange_start = trace_now();)
+    MPI_Rget_accumulate(&incumbent.sent, 1, MPI_INT, &incumbent.fetched, 1, MPI_INT,
+                        0, 0, 1, MPI_INT, MPI_MIN, incumbent.win, &incumbent.req);
+}
 
-    /* Run stable hybrid search */
-    stable_distributed_search(rank, world);
+static void incumbent_free(void)
+{
+    if (incumbent.win == MPI_WIN_NULL) return;
+    if (incumbent.req != MPI_REQUEST_NULL)
+        MPI_Wait(&incumbent.req, MPI_STATUS_IGNORE);
+    MPI_Win_unlock_all(incumbent.win);
+    MPI_Win_free(&incumbent.win);
+}
 
-    /* Synchronize results */
-    int global_best;
-    MPI_Allreduce(&best_cost, &global_best, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+/* --------------------------------------------------------------------
+ *  Dominance table: two prefixes that reach the same (visited set, city)
+ *  have identical completions, so a node is dominated by any recorded
+ *  prefix to its state that was no more expensive.  Under symmetry
+ *  breaking the allowed completions also depend on path[1], so that is
+ *  part of the key.  Entries are 16 bytes (mask, then
+ *  city + 1 | depth << 8 | first << 16 | cost << 32) and are only ever
+ *  replaced whole through a 16-byte compare-and-swap, so a prune is
+ *  decided on a consistent snapshot.  Buckets hold TT_WAYS entries; when
+ *  no slot matches, TT_DEPTH evicts the deepest entry (smallest subtree)
+ *  only if it is at least as deep as the newcomer, TT_ALWAYS always
+ *  evicts.  With --tt-merge the master thread ships a window of its
+ *  table to the next rank now and then; those are synchronous sends so
+ *  steal_shutdown can wait for them to be matched.
+ * --------------------------------------------------------------------*/
+typedef struct {
+    _Alignas(16) uint64_t mask;
+    uint64_t info;          /* 0 = empty */
+} TTEntry;
+
+typedef struct {
+    TTEntry *table;
+    uint64_t bucket_mask;
+    uint64_t cursor;        /* next bucket to ship */
+    int polls;
+    MPI_Request req;
+    TTEntry *out, *in;      /* merge buffers */
+} DominanceTable;
+
+static DominanceTable tt = { .req = MPI_REQUEST_NULL };
+
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_16
+typedef unsigned __int128 tt_word;
+
+static inline int tt_cas(TTEntry *e, TTEntry old, TTEntry new)
+{
+    tt_word o, n;
+    memcpy(&o, &old, sizeof(o));
+    memcpy(&n, &new, sizeof(n));
+    return __sync_bool_compare_and_swap((tt_word *)e, o, n);
+}
+#endif
+
+static inline uint64_t tt_hash(mask_t mask, int city)
+{
+    uint64_t h = mask ^ ((uint64_t)(city + 1) * 0x9e3779b97f4a7c15ull);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    return h ^ (h >> 29);
+}
+
+/* 1 if a prefix to (mask, city) costing at most `cost` is on record;
+ * otherwise records this one (if a slot can be had) and returns 0 */
+static int tt_dominated(mask_t mask, int city, int first, int cost, int depth)
+{
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_16
+    const uint64_t key = (uint64_t)(city + 1) | (uint64_t)first << 16;
+    const TTEntry mine = { mask, key | (uint64_t)depth << 8 | (uint64_t)(uint32_t)cost << 32 };
+    uint64_t h = tt_hash(mask, city);
+    TTEntry *b = &tt.table[(h & tt.bucket_mask) * TT_WAYS];
+
+    for (int w = 0; w < TT_WAYS; w++) {
+        for (;;) {
+            TTEntry cur = { __atomic_load_n(&b[w].mask, __ATOMIC_RELAXED),
+                            __atomic_load_n(&b[w].info, __ATOMIC_RELAXED) };
+            if (cur.mask != mask || (cur.info & 0xff00ff) != key) break;
+
+            if ((int)(cur.info >> 32) <= cost) {
+                if (tt_cas(&b[w], cur, cur)) return 1;
+            } else if (tt_cas(&b[w], cur, mine)) {
+                return 0;
+            }
+            /* lost a race against another update: look again */
+        }
+    }
+
+    int victim = -1;
+    unsigned victim_depth = 0;
+    TTEntry seen[TT_WAYS];
+    for (int w = 0; w < TT_WAYS; w++) {
+        seen[w] = (TTEntry){ __atomic_load_n(&b[w].mask, __ATOMIC_RELAXED),
+                             __atomic_load_n(&b[w].info, __ATOMIC_RELAXED) };
+        unsigned d = (unsigned)(seen[w].info >> 8) & 0xff;
+        if (seen[w].info == 0) { victim = w; break; }
+        if (victim < 0 || d > victim_depth) { victim = w; victim_depth = d; }
+    }
+    if (seen[victim].info != 0) {
+        if (opts.tt_policy == TT_ALWAYS) victim = (int)(h >> 62);
+        else if (victim_depth < (unsigned)depth) return 0;
+    }
+    tt_cas(&b[victim], seen[victim], mine);     /* best effort */
+#else
+    (void)mask; (void)city; (void)first; (void)cost; (void)depth;
+#endif
+    return 0;
+}
+
+static void tt_init(int rank)
+{
+#ifndef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_16
+    if (rank == 0)
+        fprintf(stderr, "dominance table needs a 16-byte compare-and-swap (-mcx16); disabled\n");
+#else
+    uint64_t buckets = 1;
+    while (buckets * 2 * TT_WAYS * sizeof(TTEntry) <= (uint64_t)opts.tt_mb << 20) buckets *= 2;
+    size_t bytes = buckets * TT_WAYS * sizeof(TTEntry);
+
+    tt.table = huge_alloc(bytes);
+    if (!tt.table) {
+        fprintf(stderr, "rank %d: cannot allocate %d MB dominance table\n", rank, opts.tt_mb);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    /* Every thread probes every bucket: let each zero a slice, spreading
+     * the pages over the sockets the threads run on */
+    const uint64_t entries = buckets * TT_WAYS;
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif
+    for (uint64_t b = 0; b < entries; b += HUGE_PAGE / sizeof(TTEntry)) {
+        uint64_t n = entries - b < HUGE_PAGE / sizeof(TTEntry) ? entries - b
+                                                                : HUGE_PAGE / sizeof(TTEntry);
+        memset(&tt.table[b], 0, n * sizeof(TTEntry));
+    }
+    tt.bucket_mask = buckets - 1;
+
+    if (opts.tt_merge) {
+        tt.out = malloc(2 * TT_MERGE_ENTRIES * sizeof(TTEntry));
+        if (!tt.out) { perror("malloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+        tt.in = tt.out + TT_MERGE_ENTRIES;
+    }
+
+    if (rank == 0 && !quiet)
+        printf("Dominance table: %.1f MB per rank, %d-way buckets, %s replacement%s\n",
+               bytes / 1048576.0, TT_WAYS, opts.tt_policy == TT_ALWAYS ? "always" : "depth",
+               opts.tt_merge ? ", ring merge" : "");
+#endif
+}
+
+/* Fold every pending merge message into the local table (master only) */
+static void tt_receive(void)
+{
+    int flag, bytes;
+    MPI_Status st;
+
+    for (;;) {
+        MPI_Iprobe(MPI_ANY_SOURCE, TAG_TT, comm, &flag, &st);
+        if (!flag) break;
+        MPI_Get_count(&st, MPI_BYTE, &bytes);
+        MPI_Recv(tt.in, bytes, MPI_BYTE, st.MPI_SOURCE, TAG_TT, comm,
+                 MPI_STATUS_IGNORE);
+
+        for (int i = 0; i < bytes / (int)sizeof(TTEntry); i++) {
+            const TTEntry *e = &tt.in[i];
+            tt_dominated(e->mask, (int)(e->info & 0xff) - 1, (int)(e->info >> 16) & 0xff,
+                         (int)(e->info >> 32), (int)(e->info >> 8) & 0xff);
+        }
+    }
+}
+
+/* Master thread, between incumbent polls: absorb peers' entries and,
+ * once the previous shipment was matched, send the next window */
+static void tt_exchange(void)
+{
+    if (!tt.out) return;
+    tt_receive();
+
+    int sent = 1;
+    if (tt.req != MPI_REQUEST_NULL) MPI_Test(&tt.req, &sent, MPI_STATUS_IGNORE);
+    if (!sent || ++tt.polls < TT_MERGE_INTERVAL) return;
+    tt.polls = 0;
+
+    int count = 0;
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_16
+    for (uint64_t scanned = 0; scanned <= tt.bucket_mask && count < TT_MERGE_ENTRIES; scanned++) {
+        const TTEntry *b = &tt.table[(tt.cursor++ & tt.bucket_mask) * TT_WAYS];
+        for (int w = 0; w < TT_WAYS && count < TT_MERGE_ENTRIES; w++) {
+            /* A CAS that can only fail reads the entry atomically */
+            tt_word v = __sync_val_compare_and_swap((tt_word *)&b[w], (tt_word)0, (tt_word)0);
+            memcpy(&tt.out[count], &v, sizeof(v));
+            if (tt.out[count].info != 0) count++;
+        }
+    }
+#endif
+
+    MPI_Issend(tt.out, count * (int)sizeof(TTEntry), MPI_BYTE,
+               (steal.rank + 1) % steal.world, TAG_TT, comm, &tt.req);
+}
+
+static void tt_free(void)
+{
+    free(tt.table);
+    free(tt.out);
+    tt = (DominanceTable){ .req = MPI_REQUEST_NULL };
+}
+
+static inline void node_to_task(const Node *n, const Path *path, Task *t)
+{
+    *t = (Task){
+        .depth = n->depth,
+        .cost = n->cost,
+        .city = n->city,
+        .visitedMask = n->visitedMask,
+        .path = *path
+    };
+}
+
+/* Chase-Lev work-stealing deque (C11 formulation of Le et al., PPoPP'13).
+ * The owner pushes and pops at `bottom` in LIFO order; other threads
+ * steal the oldest - shallowest - node at `top`.  Indices grow without
+ * bound and are reduced modulo the power-of-two capacity. */
+typedef struct {
+    _Alignas(64) atomic_long top;
+    _Alignas(64) atomic_long bottom;
+    Node *buf;
+    Path *paths;            /* paths[i] is the prefix of buf[i] */
+    long mask;
+} WorkDeque;
+
+/* A LIFO owner holding at most STEAL_CHUNK roots keeps at most
+ * N - d - 1 unexplored siblings per depth d below the one it is in,
+ * so (N - 1)(N - 2) / 2 + STEAL_CHUNK slots always suffice */
+static long deque_capacity(void)
+{
+    long need = (long)(N - 1) * (N - 2) / 2 + STEAL_CHUNK, capacity = 1;
+    while (capacity < need) capacity <<= 1;
+    return capacity;
+}
+
+/* Called by the owner thread, whose pushes first-touch the buffers */
+static void deque_init(WorkDeque *d, long capacity)
+{
+    d->buf = huge_alloc(capacity * sizeof(Node));
+    d->paths = huge_alloc(capacity * sizeof(Path));
+    if (!d->buf || !d->paths) { perror("aligned_alloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+    d->mask = capacity - 1;
+    atomic_init(&d->top, 0);
+    atomic_init(&d->bottom, 0);
+}
+
+static inline long deque_size(WorkDeque *d)
+{
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&d->top, memory_order_relaxed);
+    return b > t ? b - t : 0;
+}
+
+/* Owner only; the stored prefix is `prefix` with n->city appended.
+ * Returns 0 when the deque is full. */
+static inline int deque_push(WorkDeque *d, const Node *n, const Path *prefix)
+{
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    if (b - t > d->mask) return 0;
+
+    d->buf[b & d->mask] = *n;
+    d->paths[b & d->mask] = *prefix;
+    d->paths[b & d->mask].city[n->depth - 1] = n->city;
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return 1;
+}
+
+/* Owner only; returns 0 when the deque is empty.  On success *path
+ * points at the node's prefix, valid until the owner's next push. */
+static inline int deque_pop(WorkDeque *d, Node *out, const Path **path)
+{
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+    if (t > b) {
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return 0;
+    }
+
+    *out = d->buf[b & d->mask];
+    *path = &d->paths[b & d->mask];
+    if (t == b) {
+        /* Last node: race any thief for it */
+        int won = atomic_compare_exchange_strong_explicit(
+            &d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return won;
+    }
+    return 1;
+}
+
+/* Any thread; returns 0 when empty or when another thief won the race */
+static inline int deque_steal(WorkDeque *d, Node *out, Path *path)
+{
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+    if (t >= b) return 0;
+
+    /* The copy may race with the owner, but is only kept if the CAS
+     * proves slot t was still ours to take */
+    *out = d->buf[t & d->mask];
+    *path = d->paths[t & d->mask];
+    return atomic_compare_exchange_strong_explicit(
+        &d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+}
+
+/* Nodes that found their deque full anyway.  Any thread of the rank
+ * drains it before stealing, so nothing is ever dropped; the count is
+ * only changed inside the critical section. */
+typedef struct {
+    Task *tasks;
+    int cap;
+    atomic_int count;
+} OverflowPool;
+
+static OverflowPool overflow;
+
+/* Push `n` (prefix `prefix`, as for deque_push), spilling to the
+ * overflow pool when the deque is full.  Returns 0 on a spill. */
+static int deque_push_or_spill(WorkDeque *d, const Node *n, const Path *prefix)
+{
+    if (deque_push(d, n, prefix)) return 1;
+
+    Path path = *prefix;
+    path.city[n->depth - 1] = n->city;
+    Task t;
+    node_to_task(n, &path, &t);
+
+    #ifdef _OPENMP
+    #pragma omp critical(overflow)
+    #endif
+    {
+        int count = atomic_load_explicit(&overflow.count, memory_order_relaxed);
+        if (count == overflow.cap) {
+            overflow.cap = overflow.cap ? 2 * overflow.cap : 64;
+            overflow.tasks = realloc(overflow.tasks, overflow.cap * sizeof(Task));
+            if (!overflow.tasks) { perror("realloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+        }
+        overflow.tasks[count] = t;
+        atomic_store_explicit(&overflow.count, count + 1, memory_order_relaxed);
+    }
+    return 0;
+}
+
+/* Any thread; returns 0 when the pool is empty */
+static int overflow_take(Task *out)
+{
+    if (atomic_load_explicit(&overflow.count, memory_order_relaxed) == 0) return 0;
+
+    int got = 0;
+    #ifdef _OPENMP
+    #pragma omp critical(overflow)
+    #endif
+    {
+        int count = atomic_load_explicit(&overflow.count, memory_order_relaxed);
+        if (count > 0) {
+            *out = overflow.tasks[count - 1];
+            atomic_store_explicit(&overflow.count, count - 1, memory_order_relaxed);
+            got = 1;
+        }
+    }
+    return got;
+}
+
+static void overflow_free(void)
+{
+    free(overflow.tasks);
+    overflow.tasks = NULL;
+    overflow.cap = 0;
+    atomic_store(&overflow.count, 0);
+}
+
+static inline void task_to_node(const Task *task, Node *n)
+{
+    int lb = lower_bound_2edge(task->cost, task->visitedMask);
+    *n = (Node){
+        .cost = task->cost,
+        .parent_lb = lb,
+        .visitedMask = task->visitedMask,
+        .bound = node_bound(lb, task->cost, task->city, task->visitedMask, task->depth),
+        .city = (uint8_t)task->city,
+        .depth = (uint8_t)task->depth,
+        .first = task->depth >= 2 ? task->path.city[1] : 0
+    };
+}
+
+/* --------------------------------------------------------------------
+ *  Checkpoint / restart.  Every --checkpoint-interval seconds each rank
+ *  writes its search frontier (deque and overflow contents plus unclaimed
+ *  seed tasks)
+ *  and its incumbent to PREFIX.<rank>.<generation % 2>.  The master
+ *  pauses its siblings only while it copies their deques; the file is
+ *  then written with a non-blocking MPI-IO call while the search goes
+ *  on.  Tasks donated to other ranks since the previous checkpoint go
+ *  into the file too, so a task in flight between ranks is never lost
+ *  unless it stays in flight for a whole interval.  A duplicate only
+ *  costs a repeated subtree.  --restart picks the newest generation
+ *  that every writer completed and deals its tasks over the current
+ *  ranks, whatever their number.
+ * --------------------------------------------------------------------*/
+typedef struct {
+    char magic[4];          /* "WSPK" */
+    uint32_t version;       /* 1 */
+    uint32_t n;
+    uint32_t world;         /* ranks that wrote this generation */
+    uint32_t rank;
+    uint32_t generation;
+    uint64_t fingerprint;   /* of the distance matrix */
+    uint64_t checksum;      /* of the task records */
+    int32_t best_path_cost;
+    int32_t count;          /* Task records that follow */
+    uint8_t best_path[MAX_PATH + 1];
+} CheckpointHeader;
+
+/* Master thread only, except `pause` and `arrived` */
+typedef struct {
+    double next;            /* MPI_Wtime() of the next checkpoint */
+    int generation;         /* last one written or restored */
+    atomic_int pause;       /* nonzero: siblings wait at their loop top */
+    atomic_int arrived;
+    Task *log;              /* donated since the previous checkpoint */
+    int log_count, log_cap;
+    MPI_File fh;
+    MPI_Request req;
+    char *buf;              /* header and tasks being written */
+} CheckpointState;
+
+static CheckpointState ckpt = { .req = MPI_REQUEST_NULL };
+
+static uint64_t fnv1a(uint64_t h, const void *data, size_t len)
+{
+    const unsigned char *p = data;
+    for (size_t i = 0; i < len; i++) h = (h ^ p[i]) * 0x100000001b3ull;
+    return h;
+}
+
+static uint64_t matrix_fingerprint(void)
+{
+    uint64_t h = fnv1a(0xcbf29ce484222325ull, &N, sizeof(N));
+    for (int i = 0; i < N; i++) h = fnv1a(h, &DIST(i, 0), N * sizeof(int));
+    return h;
+}
+
+static void checkpoint_name(char *name, size_t len, int rank, int generation)
+{
+    snprintf(name, len, "%s.%d.%d", opts.checkpoint, rank, generation % 2);
+}
+
+/* A sibling reached its loop top holding nothing: wait out a snapshot */
+static inline void checkpoint_wait(void)
+{
+    int e = atomic_load_explicit(&ckpt.pause, memory_order_acquire);
+    if (!e) return;
+    atomic_fetch_add(&ckpt.arrived, 1);
+    while (atomic_load_explicit(&ckpt.pause, memory_order_acquire) == e)
+        sched_yield();
+}
+
+/* Remember tasks shipped to a peer until the next checkpoint */
+static void checkpoint_log(const Task *tasks, int count)
+{
+    if (!opts.checkpoint || count == 0) return;
+    if (ckpt.log_count + count > ckpt.log_cap) {
+        ckpt.log_cap = 2 * (ckpt.log_count + count);
+        ckpt.log = realloc(ckpt.log, ckpt.log_cap * sizeof(Task));
+        if (!ckpt.log) { perror("realloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+    }
+    memcpy(ckpt.log + ckpt.log_count, tasks, count * sizeof(Task));
+    ckpt.log_count += count;
+}
+
+/* Master thread, holding no node of its own.  Finishes the previous
+ * write and, once due, snapshots the rank.  An idle rank passes NULLs:
+ * its frontier is empty and no sibling needs pausing. */
+static void checkpoint_poll(WorkDeque *deques, int num_threads, TaskPool *pool)
+{
+    if (!opts.checkpoint) return;
+
+    if (ckpt.req != MPI_REQUEST_NULL) {
+        int flag;
+        MPI_Test(&ckpt.req, &flag, MPI_STATUS_IGNORE);
+        if (!flag) return;
+        MPI_File_close(&ckpt.fh);
+        free(ckpt.buf);
+        ckpt.buf = NULL;
+    }
+    if (MPI_Wtime() < ckpt.next) return;
+
+    if (deques && num_threads > 1) {
+        atomic_store(&ckpt.arrived, 0);
+        atomic_store_explicit(&ckpt.pause, ckpt.generation + 1, memory_order_release);
+        while (atomic_load_explicit(&ckpt.arrived, memory_order_acquire) < num_threads - 1)
+            ;
+    }
+
+    long count = ckpt.log_count, spilled = deques ? atomic_load(&overflow.count) : 0;
+    for (int i = 0; deques && i < num_threads; i++) count += deque_size(&deques[i]);
+    count += spilled;
+    if (pool && pool->next < pool->count) count += pool->count - pool->next;
+
+    size_t bytes = sizeof(CheckpointHeader) + count * sizeof(Task);
+    ckpt.buf = malloc(bytes);
+    if (!ckpt.buf) { perror("malloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+    Task *tasks = (Task *)(ckpt.buf + sizeof(CheckpointHeader));
+    long k = 0;
+
+    for (int i = 0; deques && i < num_threads; i++) {
+        WorkDeque *d = &deques[i];
+        long top = atomic_load(&d->top), bottom = atomic_load(&d->bottom);
+        for (long j = top; j < bottom; j++)
+            node_to_task(&d->buf[j & d->mask], &d->paths[j & d->mask], &tasks[k++]);
+    }
+    for (int t = pool ? pool->next : 0; pool && t < pool->count; t++)
+        tasks[k++] = pool->tasks[t];
+    memcpy(tasks + k, overflow.tasks, spilled * sizeof(Task));
+    k += spilled;
+
+    if (deques && num_threads > 1)
+        atomic_store_explicit(&ckpt.pause, 0, memory_order_release);
+
+    memcpy(tasks + k, ckpt.log, ckpt.log_count * sizeof(Task));
+    ckpt.log_count = 0;
+
+    CheckpointHeader *h = (CheckpointHeader *)ckpt.buf;
+    *h = (CheckpointHeader){
+        .magic = "WSPK",
+        .version = 1,
+        .n = (uint32_t)N,
+        .world = (uint32_t)steal.world,
+        .rank = (uint32_t)steal.rank,
+        .generation = (uint32_t)++ckpt.generation,
+        .fingerprint = matrix_fingerprint(),
+        .checksum = fnv1a(0xcbf29ce484222325ull, tasks, count * sizeof(Task)),
+        .count = (int32_t)count
+    };
+    #ifdef _OPENMP
+    #pragma omp critical
+    #endif
+    {
+        h->best_path_cost = best_path_cost;
+        for (int i = 0; i <= N; i++) h->best_path[i] = (uint8_t)best_path[i];
+    }
+
+    char name[FILE_NAME_MAX + 32];
+    checkpoint_name(name, sizeof(name), steal.rank, ckpt.generation);
+    if (MPI_File_open(MPI_COMM_SELF, name, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                      MPI_INFO_NULL, &ckpt.fh) != MPI_SUCCESS) {
+        fprintf(stderr, "%s: cannot open checkpoint file\n", name);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_File_set_size(ckpt.fh, (MPI_Offset)bytes);
+    MPI_File_iwrite_at(ckpt.fh, 0, ckpt.buf, (int)bytes, MPI_BYTE, &ckpt.req);
+
+    ckpt.next = MPI_Wtime() + opts.checkpoint_interval;
+}
+
+/* Wait for the last write and drop the log; the files stay behind */
+static void checkpoint_finish(void)
+{
+    if (ckpt.req != MPI_REQUEST_NULL) {
+        MPI_Wait(&ckpt.req, MPI_STATUS_IGNORE);
+        MPI_File_close(&ckpt.fh);
+    }
+    free(ckpt.buf);
+    free(ckpt.log);
+    ckpt = (CheckpointState){ .req = MPI_REQUEST_NULL };
+}
+
+/* Read the header of PREFIX.<rank>.<slot> and check it belongs to this
+ * instance and is whole; returns its file (positioned at the tasks) or NULL */
+static FILE *checkpoint_open(int rank, int slot, CheckpointHeader *h)
+{
+    char name[FILE_NAME_MAX + 32];
+    checkpoint_name(name, sizeof(name), rank, slot);
+    FILE *fp = fopen(name, "rb");
+    if (!fp) return NULL;
+
+    struct stat sb;
+    if (fread(h, sizeof(*h), 1, fp) != 1 || memcmp(h->magic, "WSPK", 4) != 0 ||
+        h->version != 1 || h->rank != (uint32_t)rank || h->count < 0 ||
+        fstat(fileno(fp), &sb) != 0 ||
+        (size_t)sb.st_size != sizeof(*h) + (size_t)h->count * sizeof(Task)) {
+        fclose(fp);
+        return NULL;
+    }
+    if (h->n != (uint32_t)N || h->fingerprint != matrix_fingerprint()) {
+        fprintf(stderr, "%s: checkpoint of a different instance\n", name);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    return fp;
+}
+
+/* Load the newest complete generation: every rank reads every file, so
+ * all agree on the task list and each keeps every world-th task.
+ * Restores the incumbent and returns the tasks (count in *total). */
+static Task *checkpoint_load(int rank, int *total)
+{
+    /* Newest first; a generation counts only if all its writers finished */
+    CheckpointHeader h0[2];
+    int gen[2] = { -1, -1 };
+    for (int slot = 0; slot < 2; slot++) {
+        FILE *fp = checkpoint_open(0, slot, &h0[slot]);
+        if (fp) { gen[slot] = (int)h0[slot].generation; fclose(fp); }
+    }
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        int slot = (gen[0] > gen[1]) == (attempt == 0) ? 0 : 1;
+        if (gen[slot] < 0) continue;
+
+        int world = (int)h0[slot].world;
+        Task *tasks = NULL;
+        int count = 0, ok = 1, best = INT_MAX;
+        uint8_t path[MAX_PATH + 1] = { 0 };
+
+        for (int r = 0; r < world && ok; r++) {
+            CheckpointHeader h;
+            FILE *fp = checkpoint_open(r, slot, &h);
+            ok = fp && (int)h.generation == gen[slot] && (int)h.world == world;
+            if (ok) {
+                tasks = realloc(tasks, (count + h.count + 1) * sizeof(Task));
+                if (!tasks) { perror("realloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+                ok = fread(tasks + count, sizeof(Task), h.count, fp) == (size_t)h.count &&
+                     fnv1a(0xcbf29ce484222325ull, tasks + count,
+                           h.count * sizeof(Task)) == h.checksum;
+                count += h.count;
+                if (ok && h.best_path_cost < best) {
+                    best = h.best_path_cost;
+                    memcpy(path, h.best_path, sizeof(path));
+                }
+            }
+            if (fp) fclose(fp);
+        }
+        if (!ok) { free(tasks); continue; }
+
+        if (best < best_path_cost) {
+            incumbent_lower(best);
+            best_path_cost = best;
+            for (int i = 0; i <= N; i++) best_path[i] = path[i];
+            stats_tour();
+        }
+        ckpt.generation = gen[slot];
+        *total = count;
+        if (rank == 0 && !quiet)
+            printf("Restart: generation %d of %s (%d ranks), %d tasks, incumbent %d\n",
+                   gen[slot], opts.checkpoint, world, count, best_path_cost);
+        return tasks;
+    }
+
+    if (rank == 0)
+        fprintf(stderr, "%s: no complete checkpoint to restart from\n", opts.checkpoint);
+    MPI_Abort(MPI_COMM_WORLD, 1);
+    return NULL;
+}
+
+/* Answer every queued steal request.  A busy rank first donates seed
+ * tasks nobody has claimed yet, otherwise steals up to half of each
+ * thread's deque from the shallow end, capped at STEAL_CHUNK.  An idle
+ * rank passes NULLs and always declines. */
+static void service_steal_requests(WorkDeque *deques, int num_threads, TaskPool *pool)
+{
+    int flag;
+    MPI_Status st;
+
+    for (;;) {
+        MPI_Iprobe(MPI_ANY_SOURCE, TAG_STEAL_REQ, comm, &flag, &st);
+        if (!flag) break;
+        MPI_Recv(NULL, 0, MPI_BYTE, st.MPI_SOURCE, TAG_STEAL_REQ,
+                 comm, MPI_STATUS_IGNORE);
+
+        StealMsg msg;
+        msg.count = 0;
+
+        if (pool) {
+            int first;
+            #ifdef _OPENMP
+            #pragma omp atomic capture
+            #endif
+            { first = pool->next; pool->next += STEAL_CHUNK; }
+
+            for (int t = first; t < pool->count && msg.count < STEAL_CHUNK; t++)
+                msg.tasks[msg.count++] = pool->tasks[t];
+        }
+
+        for (int i = 0; deques && i < num_threads && msg.count < STEAL_CHUNK; i++) {
+            Node n;
+            Path path;
+            for (long give = deque_size(&deques[i]) / 2;
+                 give > 0 && msg.count < STEAL_CHUNK; give--) {
+                if (!deque_steal(&deques[i], &n, &path)) break;
+                node_to_task(&n, &path, &msg.tasks[msg.count++]);
+            }
+        }
+
+        if (msg.count > 0) steal.counter++;
+        checkpoint_log(msg.tasks, msg.count);
+        TRACE(trace_instant(TR_SERVE, msg.count, st.MPI_SOURCE);)
+
+        MPI_Send(&msg, (int)(sizeof(int) + msg.count * sizeof(Task)), MPI_BYTE,
+                 st.MPI_SOURCE, TAG_STEAL_REPLY, comm);
+    }
+}
+
+/* Forward the termination token, or on rank 0 decide whether the probe
+ * that came back proved global termination and otherwise start a new one.
+ * Called only while this rank is idle. */
+static void pass_token(void)
+{
+    if (!steal.have_token) return;
+    steal.have_token = 0;
+
+    if (steal.rank == 0) {
+        if (steal.probing &&
+            steal.token_color == WHITE && steal.color == WHITE &&
+            steal.token_count + steal.counter == 0) {
+            for (int r = 1; r < steal.world; r++)
+                MPI_Send(NULL, 0, MPI_BYTE, r, TAG_DONE, comm);
+            steal.done = 1;
+            return;
+        }
+        steal.probing = 1;
+        steal.token_color = WHITE;
+        steal.token_count = 0;
+    } else {
+        steal.token_count += steal.counter;
+        if (steal.color == BLACK) steal.token_color = BLACK;
+    }
+
+    int token[2] = { steal.token_color, steal.token_count };
+    MPI_Send(token, 2, MPI_INT, (steal.rank + 1) % steal.world, TAG_TOKEN,
+             comm);
+    steal.color = WHITE;
+}
+
+/* Idle loop: ask random victims for work until some arrives (returns the
+ * number of tasks written to `out`) or termination is detected (returns 0). */
+static int steal_work(Task *out)
+{
+    for (;;) {
+        pass_token();
+        checkpoint_poll(NULL, 0, NULL);
+        anytime_poll();
+
+        if (steal.done && !steal.pending) return 0;
+
+        if (!steal.pending && !steal.done) {
+            steal.seed = steal.seed * 1103515245u + 12345u;
+            int victim = (int)((steal.seed >> 16) % (unsigned)(steal.world - 1));
+            if (victim >= steal.rank) victim++;
+            MPI_Send(NULL, 0, MPI_BYTE, victim, TAG_STEAL_REQ, comm);
+            steal.pending = 1;
+            TRACE(if (trace.rings) { trace.steal_start = trace_now(); trace.steal_victim = victim; })
+        }
+
+        MPI_Status st;
+        MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, comm, &st);
+
+        switch (st.MPI_TAG) {
+        case TAG_STEAL_REQ:
+            service_steal_requests(NULL, 0, NULL);
+            break;
+
+        case TAG_STEAL_REPLY: {
+            StealMsg msg;
+            MPI_Recv(&msg, sizeof(msg), MPI_BYTE, st.MPI_SOURCE, TAG_STEAL_REPLY,
+                     comm, MPI_STATUS_IGNORE);
+            steal.pending = 0;
+            TRACE(trace_span(TR_STEAL_REMOTE, trace.steal_start, msg.count, trace.steal_victim);)
+            if (msg.count > 0) {
+                steal.counter--;
+                steal.color = BLACK;
+                memcpy(out, msg.tasks, msg.count * sizeof(Task));
+                return msg.count;
+            }
+            break;
+        }
+
+        case TAG_TOKEN: {
+            int token[2];
+            MPI_Recv(token, 2, MPI_INT, st.MPI_SOURCE, TAG_TOKEN,
+                     comm, MPI_STATUS_IGNORE);
+            steal.have_token = 1;
+            steal.token_color = token[0];
+            steal.token_count = token[1];
+            break;
+        }
+
+        case TAG_DONE:
+            MPI_Recv(NULL, 0, MPI_BYTE, st.MPI_SOURCE, TAG_DONE,
+                     comm, MPI_STATUS_IGNORE);
+            steal.done = 1;
+            break;
+
+        case TAG_TT:
+            tt_receive();
+            break;
+
+        default:
+            fprintf(stderr, "rank %d: unexpected tag %d\n", steal.rank, st.MPI_TAG);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+}
+
+/* Every rank has its own steal answered by now, but peers may still be
+ * waiting on theirs: keep declining requests until all ranks get here.
+ * A dominance-table shipment must be matched before the barrier, so no
+ * merge message is left in flight once it completes. */
+static void steal_shutdown(void)
+{
+    MPI_Request barrier;
+    int finished = 0;
+
+    while (tt.req != MPI_REQUEST_NULL) {
+        service_steal_requests(NULL, 0, NULL);
+        tt_receive();
+        MPI_Test(&tt.req, &finished, MPI_STATUS_IGNORE);
+    }
+
+    finished = 0;
+    MPI_Ibarrier(comm, &barrier);
+    while (!finished) {
+        service_steal_requests(NULL, 0, NULL);
+        if (tt.out) tt_receive();
+        MPI_Test(&barrier, &finished, MPI_STATUS_IGNORE);
+    }
+}
+
+/* Find work for an idle thread: steal from a random sibling, and once
+ * every thread of the rank is idle let the master steal from other
+ * ranks.  `idle` counts threads that hold no node; a thief leaves the
+ * count before it tries a victim, so idle == num_threads only when no
+ * thread can still produce work.  Returns 0 when the search is over. */
+static int find_work(WorkDeque *deques, int thread_id, int num_threads,
+                     TaskPool *pool, atomic_int *idle, atomic_int *finished,
+                     unsigned *seed, Node *out, Path *out_path)
+{
+    const int master = (thread_id == 0);
+
+    atomic_fetch_add(idle, 1);
+
+    for (;;) {
+        if (atomic_load(finished)) return 0;
+
+        if (master && steal.world > 1) {
+            service_steal_requests(deques, num_threads, pool);
+            poll_incumbent();
+            if (tt.out) tt_receive();
+        }
+        if (master) {
+            checkpoint_poll(deques, num_threads, pool);
+            anytime_poll();
+        } else {
+            checkpoint_wait();
+        }
+
+        /* Spilled nodes first: they belong to this rank alone */
+        if (atomic_load_explicit(&overflow.count, memory_order_relaxed) > 0) {
+            Task t;
+            atomic_fetch_sub(idle, 1);
+            if (overflow_take(&t)) {
+                task_to_node(&t, out);
+                *out_path = t.path;
+                return 1;
+            }
+            atomic_fetch_add(idle, 1);
+        }
+
+        if (num_threads > 1) {
+            *seed = *seed * 1103515245u + 12345u;
+            int victim = (int)((*seed >> 16) % (unsigned)(num_threads - 1));
+            if (victim >= thread_id) victim++;
+
+            if (deque_size(&deques[victim]) > 0) {
+                atomic_fetch_sub(idle, 1);
+                int stolen = deque_steal(&deques[victim], out, out_path);
+                TRACE(trace_instant(TR_STEAL, stolen, victim);)
+                if (stolen) return 1;
+                atomic_fetch_add(idle, 1);
+            }
+        }
+
+        /* Only a thread holding a node can spill, so the rank is dry
+         * once every thread is idle with the pool empty */
+        int dry = 0;
+        if (master && atomic_load(idle) == num_threads) {
+            #ifdef _OPENMP
+            #pragma omp critical(overflow)
+            #endif
+            dry = atomic_load(idle) == num_threads && atomic_load(&overflow.count) == 0;
+        }
+
+        if (dry) {
+            /* Whole rank is dry: ask the other ranks */
+            Task got[STEAL_CHUNK];
+            int count = steal.world > 1 ? steal_work(got) : 0;
+            if (count == 0) {
+                atomic_store(finished, 1);
+                return 0;
+            }
+
+            atomic_fetch_sub(idle, 1);
+            for (int i = 1; i < count; i++) {
+                Node n;
+                task_to_node(&got[i], &n);
+                deque_push_or_spill(&deques[thread_id], &n, &got[i].path);
+            }
+            task_to_node(&got[0], out);
+            *out_path = got[0].path;
+            return 1;
+        }
+
+        if (!master) sched_yield();
+    }
+}
+
+/* --------------------------------------------------------------------
+ *  Subset ranking shared by the suffix table and the Held-Karp engine.
+ *  Subsets are of cities 1..N-1, city c being bit c-1.
+ * --------------------------------------------------------------------*/
+static uint64_t binom[MAX_N][MAX_N + 1];
+
+static void init_binomials(int m)
+{
+    memset(binom, 0, sizeof(binom));
+    for (int n = 0; n <= m; n++) {
+        binom[n][0] = 1;
+        for (int k = 1; k <= n; k++)
+            binom[n][k] = binom[n - 1][k - 1] + (k <= n - 1 ? binom[n - 1][k] : 0);
+    }
+}
+
+/* Colex rank of a subset among subsets of the same size */
+static inline uint64_t subset_rank(uint64_t S)
+{
+    uint64_t r = 0;
+    for (int i = 1; S; i++) {
+        r += binom[__builtin_ctzll(S)][i];
+        S &= S - 1;
+    }
+    return r;
+}
+
+static uint64_t subset_unrank(uint64_t r, int k, int m)
+{
+    uint64_t S = 0;
+    for (int p = m - 1; k > 0; p--) {
+        if (binom[p][k] <= r) {
+            r -= binom[p][k];
+            S |= (uint64_t)1 << p;
+            k--;
+        }
+    }
+    return S;
+}
+
+/* Next larger integer with the same popcount (Gosper's hack) */
+static inline uint64_t next_subset(uint64_t S)
+{
+    uint64_t c = S & -S, r = S + c;
+    return (((r ^ S) >> 2) / c) | r;
+}
+
+/* --------------------------------------------------------------------
+ *  Suffix table: g(S, c) = cheapest way to leave city c, visit every city
+ *  of S and return to 0, for all |S| <= k.  A node with at most k cities
+ *  left is finished by one lookup instead of a subtree of pushes and
+ *  pops.  Level s holds C(N-1, s) subsets in colex order with N entries
+ *  each, so any current city indexes directly.
+ * --------------------------------------------------------------------*/
+typedef struct {
+    int k;
+    int *g;                     /* node-shared */
+    size_t level_ofs[MAX_N + 1];
+    MPI_Win win;
+} SuffixTable;
+
+static SuffixTable suffix = { .win = MPI_WIN_NULL };
+
+static inline int suffix_cost(uint64_t S, int c, const int N)
+{
+    return suffix.g[suffix.level_ofs[__builtin_popcountll(S)] + subset_rank(S) * N + c];
+}
+
+/* The node's ranks split every level between them.  Collective over
+ * node.comm. */
+static void suffix_init(int rank)
+{
+    const int m = N - 1;
+    init_binomials(m);
+
+    int k = opts.suffix_k;
+    if (k < 0) {
+        /* Deepest table within budget, never reaching the seed levels */
+        size_t total = (size_t)N;
+        for (k = 0; k < SUFFIX_MAX_K && k + 1 <= N - 3; k++) {
+            total += binom[m][k + 1] * N;
+            if (total * sizeof(int) > (size_t)SUFFIX_BUDGET_MB << 20) break;
+        }
+    }
+    if (k > m) k = m;
+    suffix.k = k;
+    if (k <= 0) return;
+
+    suffix.level_ofs[0] = 0;
+    for (int s = 0; s < k; s++) suffix.level_ofs[s + 1] = suffix.level_ofs[s] + binom[m][s] * N;
+    size_t entries = suffix.level_ofs[k] + binom[m][k] * N;
+
+    suffix.g = node_alloc(entries * sizeof(int), &suffix.win);
+
+    if (node.rank == 0)
+        for (int c = 0; c < N; c++) suffix.g[c] = DIST(c, 0);
+    node_sync(suffix.win);
+
+    for (int s = 1; s <= k; s++) {
+        const int *prev = suffix.g + suffix.level_ofs[s - 1];
+        int *cur = suffix.g + suffix.level_ofs[s];
+        const long subsets = (long)binom[m][s];
+        const long lo = subsets * node.rank / node.size;
+        const long hi = subsets * (node.rank + 1) / node.size;
+
+        #ifdef _OPENMP
+        #pragma omp parallel for schedule(static)
+        #endif
+        for (long r = lo; r < hi; r++) {
+            uint64_t S = subset_unrank((uint64_t)r, s, m);
+            int member[MAX_N];
+            uint64_t sub_rank[MAX_N], pre = 0, suf = 0;
+
+            uint64_t bits = S;
+            for (int q = 0; q < s; q++) {
+                member[q] = __builtin_ctzll(bits);
+                bits &= bits - 1;
+            }
+            /* rank(S \ member[q]) from prefix and shifted suffix sums */
+            for (int q = s - 1; q >= 0; q--) {
+                sub_rank[q] = suf;
+                suf += binom[member[q]][q];
+            }
+            for (int q = 0; q < s; q++) {
+                sub_rank[q] += pre;
+                pre += binom[member[q]][q + 1];
+            }
+
+            int *out = cur + r * N;
+            for (int c = 0; c < N; c++) {
+                int best = INT_MAX;
+                for (int q = 0; q < s; q++) {
+                    int j = member[q] + 1;
+                    int v = DIST(c, j) + prev[sub_rank[q] * N + j];
+                    if (v < best) best = v;
+                }
+                out[c] = best;
+            }
+        }
+        node_sync(suffix.win);
+    }
+
+    if (rank == 0 && !quiet)
+        printf("Suffix table: last %d cities, %.1f MB per node\n",
+               k, entries * sizeof(int) / 1048576.0);
+}
+
+/* Append the optimal completion of (S, c) to path[from..N-1] */
+static void suffix_path(uint64_t S, int c, int *path, int from)
+{
+    while (S) {
+        int target = suffix_cost(S, c, N);
+        for (uint64_t bits = S; bits; bits &= bits - 1) {
+            int j = __builtin_ctzll(bits) + 1;
+            uint64_t rest = S & ~((uint64_t)1 << (j - 1));
+            if (DIST(c, j) + suffix_cost(rest, j, N) == target) {
+                path[from++] = j;
+                S = rest;
+                c = j;
+                break;
+            }
+        }
+    }
+}
+
+static void suffix_free(void)
+{
+    node_release(&suffix.win);
+    suffix = (SuffixTable){ .win = MPI_WIN_NULL };
+}
+
+/* Threads of one stable_hybrid_dfs call */
+typedef struct {
+    WorkDeque *deques;
+    int num_threads;
+    TaskPool *pool;
+    atomic_int idle, finished;
+} DfsShared;
+
+/* Hybrid DFS worker: each OpenMP thread runs LIFO search on its own
+ * Chase-Lev deque, refilling it from the seed pool and, once the pool
+ * is drained, by stealing the shallowest nodes of its siblings.  The
+ * master thread also serves and issues inter-rank steals.  Inlined
+ * into every kernel below with N a constant. */
+static inline __attribute__((always_inline))
+void dfs_thread(DfsShared *sh, int thread_id, const int N)
+{
+    KERNEL_GEOMETRY;
+    WorkDeque *deques = sh->deques;
+    const int num_threads = sh->num_threads;
+    TaskPool *pool = sh->pool;
+    WorkDeque *my = &deques[thread_id];
+    deque_init(my, deque_capacity());
+    unsigned seed = 0x2545f491u * (unsigned)(thread_id + 1);
+
+    #ifdef _OPENMP
+    #pragma omp barrier
+    #endif
+
+    /* Master thread answers remote steal requests while searching */
+    const int serve = (thread_id == 0 && steal.world > 1);
+    int polls = 0, master_polls = 0;
+    int floor = INT_MAX;        /* least bound of a node dropped on stop */
+    STAT(SearchStats st = { 0 };)
+    TRACE(double task_start = -1; int task_seed = -1;)
+
+    /* Main DFS loop */
+    for (;;) {
+        Node n;
+        const Path *n_path;
+        Path claimed;           /* prefix of a node not popped from `my` */
+
+        /* Between nodes a thread's whole frontier is in its deque */
+        if (thread_id != 0) {
+            checkpoint_wait();
+        } else if (++master_polls % STEAL_POLL_INTERVAL == 0) {
+            checkpoint_poll(deques, num_threads, pool);
+            anytime_poll();
+        }
+
+        if (!deque_pop(my, &n, &n_path)) {
+            /* Own deque empty: the last task is searched out */
+            TRACE(if (task_start >= 0) trace_span(TR_TASK, task_start, task_seed, -1);)
+
+            int t;
+            #ifdef _OPENMP
+            #pragma omp atomic capture
+            #endif
+            t = pool->next++;
+
+            if (t < pool->count) {
+                task_to_node(&pool->tasks[t], &n);
+                claimed = pool->tasks[t].path;
+            } else {
+                TRACE(double wait = trace.rings ? trace_now() : 0;)
+                int found = find_work(deques, thread_id, num_threads, pool,
+                                      &sh->idle, &sh->finished, &seed, &n, &claimed);
+                TRACE(trace_span(TR_FIND_WORK, wait, found, -1);)
+                if (!found) break;
+            }
+            n_path = &claimed;
+            TRACE(
+                task_start = trace.rings ? trace_now() : -1;
+                task_seed = t < pool->count ? t : -1;
+            )
+        }
+
+        if (serve && ++polls % STEAL_POLL_INTERVAL == 0) {
+            service_steal_requests(deques, num_threads, pool);
+            if (polls == BOUND_UPDATE_INTERVAL) {
+                polls = 0;
+                poll_incumbent();
+                tt_exchange();
+            }
+        }
+
+        /* Get current best cost (thread-safe read) */
+        int current_best;
+        #ifdef _OPENMP
+        #pragma omp atomic read
+        #endif
+        current_best = *best_cost;
+
+        /* Stopped early: drop the node, keeping what it could still hold */
+        if (atomic_load_explicit(&anytime.stop, memory_order_relaxed)) {
+            int lb = n.bound > n.cost ? n.bound : n.cost;
+            if (lb < floor) floor = lb;
+            continue;
+        }
+
+        /* Enhanced pruning */
+        if (n.cost >= current_best || n.bound >= current_best) {
+            STAT(if (n.cost >= current_best) st.pruned_cost++; else st.pruned_bound++;)
+            continue;
+        }
+
+        /* Few enough cities left: finish from the suffix table */
+        if (suffix.k > 0 && N - n.depth <= suffix.k) {
+            uint64_t rest = (~n.visitedMask & all_cities) >> 1;
+            int tour_cost = n.cost + suffix_cost(rest, n.city, N);
+            STAT(st.suffix++;)
+            if (tour_cost < current_best) {
+                #ifdef _OPENMP
+                #pragma omp critical
+                #endif
+                {
+                    if (incumbent_lower(tour_cost)) {
+                        best_path_cost = tour_cost;
+                        for (int i = 0; i < n.depth; i++) best_path[i] = n_path->city[i];
+                        suffix_path(rest, n.city, best_path, n.depth);
+                        best_path[N] = 0;
+                        stats_tour();
+                    }
+                }
+            }
+            continue;
+        }
+
+        /* A no-dearer prefix to the same state is, or was, searched */
+        if (tt.table && n.depth >= 3 && n.depth <= N - 3 &&
+            tt_dominated(n.visitedMask, n.city, symmetric ? n.first : 0, n.cost, n.depth)) {
+            STAT(st.dominated++;)
+            continue;
+        }
+
+        /* Complete tour check */
+        if (n.depth == N) {
+            int tour_cost = n.cost + DIST(n.city, 0);
+            if (tour_cost < current_best) {
+                #ifdef _OPENMP
+                #pragma omp critical
+                #endif
+                {
+                    if (incumbent_lower(tour_cost)) {
+                        best_path_cost = tour_cost;
+                        for (int i = 0; i < N; i++) best_path[i] = n_path->city[i];
+                        best_path[N] = 0;
+                        stats_tour();
+                    }
+                }
+            }
+            STAT(if (tour_cost >= current_best) st.pruned_closing++;)
+            continue;
+        }
+
+        /* Children overwrite n's deque slot, so keep its prefix */
+        const Path prefix = *n_path;
+
+        /* Map the surviving children to their positions in the
+         * precomputed nearest-first order; scanning that mask from the
+         * top yields them farthest first in O(children) */
+        const uint8_t *nb = bounds->neighbours[n.city];
+        const uint8_t *rank_of = bounds->neighbour_rank[n.city];
+        uint64_t order = 0;
+        mask_t live = surviving_children(&n, current_best, N);
+        STAT(
+            st.expanded++;
+            st.pruned_child += __builtin_popcountll(~n.visitedMask & all_cities) -
+                               __builtin_popcountll(live);
+        )
+        while (live) {
+            order |= (uint64_t)1 << rank_of[__builtin_ctzll(live)];
+            live &= live - 1;
+        }
+        
+        /* Add children in reverse order (stack is LIFO) */
+        while (order) {
+            int r = 63 - __builtin_clzll(order);
+            order &= ~((uint64_t)1 << r);
+            int next = nb[r];
+            int new_cost = n.cost + DIST(n.city, next);
+            int new_lb = incremental_lower_bound(n.parent_lb, n.city, next, N);
+            
+            mask_t new_mask = n.visitedMask | ((mask_t)1 << next);
+            int new_bound = node_bound(new_lb, new_cost, next, new_mask, n.depth + 1);
+            if (new_bound >= current_best) { STAT(st.pruned_child++;) continue; }
+
+            const Node child = {
+                .cost = new_cost,
+                .parent_lb = new_lb,
+                .visitedMask = new_mask,
+                .bound = new_bound,
+                .city = (uint8_t)next,
+                .depth = (uint8_t)(n.depth + 1),
+                .first = n.depth == 1 ? (uint8_t)next : n.first
+            };
+            if (!deque_push_or_spill(my, &child, &prefix)) { STAT(st.spilled++;) }
+        }
+        STAT(
+            uint64_t depth = (uint64_t)deque_size(my);
+            if (depth > st.high_water) st.high_water = depth;
+        )
+    }
+
+    if (floor < INT_MAX) {
+        #ifdef _OPENMP
+        #pragma omp critical
+        #endif
+        if (floor < anytime.floor) anytime.floor = floor;
+    }
+
+    #ifndef WSP_NO_STATS
+    #ifdef _OPENMP
+    #pragma omp critical
+    #endif
+    {
+        uint64_t *to = (uint64_t *)&stats.total;
+        const uint64_t *from = (const uint64_t *)&st;
+        for (size_t f = 0; f + 1 < STATS_FIELDS; f++) to[f] += from[f];
+        if (st.high_water > stats.total.high_water)
+            stats.total.high_water = st.high_water;
+        if (st.expanded < stats.thread_min) stats.thread_min = st.expanded;
+        if (st.expanded > stats.thread_max) stats.thread_max = st.expanded;
+    }
+    #endif
+
+    #ifdef _OPENMP
+    #pragma omp barrier
+    #endif
+    free(my->buf);
+    free(my->paths);
+}
+
+/* One kernel per city count in KERNEL_SIZES, plus a generic one reading
+ * N at run time; stable_hybrid_dfs dispatches on the instance's N */
+typedef void (*DfsKernel)(DfsShared *sh, int thread_id);
+
+#define KERNEL_DEFINE(K) \
+    static void dfs_kernel_##K(DfsShared *sh, int thread_id) { dfs_thread(sh, thread_id, K); }
+#define KERNEL_ENTRY(K) [K] = dfs_kernel_##K,
+
+KERNEL_SIZES(KERNEL_DEFINE)
+
+static void dfs_kernel_any(DfsShared *sh, int thread_id)
+{
+    dfs_thread(sh, thread_id, N);
+}
+
+static const DfsKernel dfs_kernels[MAX_N + 1] = { [0] = NULL, KERNEL_SIZES(KERNEL_ENTRY) };
+
+static void stable_hybrid_dfs(TaskPool *pool)
+{
+    #ifdef _OPENMP
+    int num_threads = omp_get_max_threads();
+    #else
+    int num_threads = 1;
+    #endif
+
+    DfsShared sh = { .num_threads = num_threads, .pool = pool };
+    sh.deques = aligned_alloc(_Alignof(WorkDeque), num_threads * sizeof(WorkDeque));
+    if (!sh.deques) { perror("aligned_alloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+    atomic_init(&sh.idle, 0);
+    atomic_init(&sh.finished, 0);
+    pool->next = 0;
+
+    const DfsKernel kernel = dfs_kernels[N] ? dfs_kernels[N] : dfs_kernel_any;
+
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(num_threads) shared(sh)
+    kernel(&sh, omp_get_thread_num());
+#else
+    kernel(&sh, 0);
+#endif
+
+    free(sh.deques);
+    overflow_free();
+}
+
+/* --------------------------------------------------------------------
+ *  Best-first phase (--best-first MB).  Before the DFS starts, the rank
+ *  expands its share of seeds in order of bound, least first, from a
+ *  binary heap.  Each round the master pops the BEST_FIRST_BATCH least
+ *  nodes per thread, the thread team expands them, and the master pushes
+ *  their children.  Tours completed on the way, or finished from the
+ *  suffix table, lower the incumbent.  Once the heap would outgrow its
+ *  budget, the nodes still in it replace the seed pool, least bound
+ *  first, so the DFS dives from the most promising nodes.  Between rounds
+ *  the master polls like the DFS master does; a checkpoint taken meanwhile
+ *  saves the untouched seed pool, and a stop hands the heap to the DFS,
+ *  which drops it and records its bounds.
+ * --------------------------------------------------------------------*/
+typedef struct {
+    Node n;
+    Path path;
+} HeapEntry;
+
+/* Least bound on top; deeper first on ties, to reach tours sooner */
+static inline int heap_before(const HeapEntry *a, const HeapEntry *b)
+{
+    return a->n.bound < b->n.bound || (a->n.bound == b->n.bound && a->n.depth > b->n.depth);
+}
+
+static void heap_push(HeapEntry *heap, size_t *size, const Node *n, const Path *path)
+{
+    size_t i = (*size)++;
+    HeapEntry e = { *n, *path };
+    while (i > 0 && heap_before(&e, &heap[(i - 1) / 2])) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = e;
+}
+
+static void heap_pop(HeapEntry *heap, size_t *size, HeapEntry *out)
+{
+    *out = heap[0];
+    HeapEntry last = heap[--*size];
+    size_t i = 0;
+    for (;;) {
+        size_t c = 2 * i + 1;
+        if (c >= *size) break;
+        if (c + 1 < *size && heap_before(&heap[c + 1], &heap[c])) c++;
+        if (!heap_before(&heap[c], &last)) break;
+        heap[i] = heap[c];
+        i = c;
+    }
+    if (*size > 0) heap[i] = last;
+}
+
+/* Sort key of a leftover heap entry, so the final sort moves 16 bytes
+ * instead of a whole node and path */
+typedef struct {
+    int bound, depth;
+    size_t index;
+} HeapKey;
+
+/* heap_before's order */
+static int compare_heap_key(const void *a, const void *b)
+{
+    const HeapKey *x = a, *y = b;
+    if (x->bound != y->bound) return x->bound < y->bound ? -1 : 1;
+    return (x->depth < y->depth) - (x->depth > y->depth);
+}
+
+/* Bounds of the leftover nodes usually span a few thousand values, so a
+ * counting sort on (bound, depth) orders them in linear time; wide spans
+ * fall back to qsort */
+static void sort_heap_keys(HeapKey *key, size_t n)
+{
+    if (n < 2) return;
+    int lo = key[0].bound, hi = key[0].bound;
+    for (size_t i = 1; i < n; i++) {
+        if (key[i].bound < lo) lo = key[i].bound;
+        if (key[i].bound > hi) hi = key[i].bound;
+    }
+    const size_t buckets = ((size_t)hi - lo + 1) * (MAX_N + 1);
+    size_t *count = buckets <= 4 * n ? calloc(buckets + 1, sizeof(size_t)) : NULL;
+    HeapKey *out = count ? malloc(n * sizeof(HeapKey)) : NULL;
+    if (!out) {
+        free(count);
+        qsort(key, n, sizeof(HeapKey), compare_heap_key);
+        return;
+    }
+
+    #define HEAP_BUCKET(k) ((size_t)((k).bound - lo) * (MAX_N + 1) + (MAX_N - (k).depth))
+    for (size_t i = 0; i < n; i++) count[HEAP_BUCKET(key[i]) + 1]++;
+    for (size_t b = 1; b <= buckets; b++) count[b] += count[b - 1];
+    for (size_t i = 0; i < n; i++) out[count[HEAP_BUCKET(key[i])]++] = key[i];
+    #undef HEAP_BUCKET
+
+    memcpy(key, out, n * sizeof(HeapKey));
+    free(out);
+    free(count);
+}
+
+/* Lower the incumbent to `cost`, a tour through `path`'s first `depth`
+ * cities and then, if `rest` is nonzero, the suffix path over it */
+static void best_first_tour(int cost, const Path *path, int depth, int city, uint64_t rest)
+{
+    if (!incumbent_lower(cost)) return;
+    best_path_cost = cost;
+    for (int i = 0; i < depth; i++) best_path[i] = path->city[i];
+    if (rest) suffix_path(rest, city, best_path, depth);
+    best_path[N] = 0;
+    stats_tour();
+}
+
+/* Close or expand one popped node against `best` (any thread).  Its
+ * children go to `kids`; returns how many, or -1 if it was not expanded. */
+static int best_first_expand(const HeapEntry *e, HeapEntry *kids)
+{
+    const Node *n = &e->n;
+    int best = __atomic_load_n(best_cost, __ATOMIC_RELAXED);
+    if (n->cost >= best || n->bound >= best) return -1;
+
+    if (suffix.k > 0 && N - n->depth <= suffix.k) {
+        uint64_t rest = (~n->visitedMask & all_cities) >> 1;
+        int tour_cost = n->cost + suffix_cost(rest, n->city, N);
+        if (tour_cost < best) {
+            #ifdef _OPENMP
+            #pragma omp critical
+            #endif
+            best_first_tour(tour_cost, &e->path, n->depth, n->city, rest);
+        }
+        return -1;
+    }
+    if (n->depth == N) {
+        int tour_cost = n->cost + DIST(n->city, 0);
+        if (tour_cost < best) {
+            #ifdef _OPENMP
+            #pragma omp critical
+            #endif
+            best_first_tour(tour_cost, &e->path, N, n->city, 0);
+        }
+        return -1;
+    }
+
+    int count = 0;
+    for (mask_t live = surviving_children(n, best, N); live; live &= live - 1) {
+        int next = __builtin_ctzll(live);
+        int new_cost = n->cost + DIST(n->city, next);
+        int new_lb = incremental_lower_bound(n->parent_lb, n->city, next, N);
+        mask_t new_mask = n->visitedMask | ((mask_t)1 << next);
+        int new_bound = node_bound(new_lb, new_cost, next, new_mask, n->depth + 1);
+        if (new_bound >= best) continue;
+
+        HeapEntry *k = &kids[count++];
+        k->n = (Node){
+            .cost = new_cost,
+            .parent_lb = new_lb,
+            .visitedMask = new_mask,
+            .bound = new_bound,
+            .city = (uint8_t)next,
+            .depth = (uint8_t)(n->depth + 1),
+            .first = n->depth == 1 ? (uint8_t)next : n->first
+        };
+        k->path = e->path;
+        k->path.city[n->depth] = (uint8_t)next;
+    }
+    return count;
+}
+
+static void best_first_phase(TaskPool *pool)
+{
+    if (!opts.best_first_mb || pool->count == 0) return;
+    double t0 = wall_time();
+
+    #ifdef _OPENMP
+    const int threads = omp_get_max_threads();
+    #else
+    const int threads = 1;
+    #endif
+    const size_t batch = (size_t)BEST_FIRST_BATCH * threads;
+
+    size_t cap = ((size_t)opts.best_first_mb << 20) / sizeof(HeapEntry);
+    if (cap < (size_t)pool->count + N) cap = (size_t)pool->count + N;
+    HeapEntry *heap = malloc(cap * sizeof(HeapEntry));
+    HeapEntry *work = malloc(batch * sizeof(HeapEntry));
+    HeapEntry *kids = malloc(batch * N * sizeof(HeapEntry));
+    int *kid_count = malloc(batch * sizeof(int));
+    if (!heap || !work || !kids || !kid_count) { perror("malloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+
+    size_t size = 0;
+    for (int t = 0; t < pool->count; t++) {
+        Node n;
+        task_to_node(&pool->tasks[t], &n);
+        heap_push(heap, &size, &n, &pool->tasks[t].path);
+    }
+
+    /* A round pops at most `batch` nodes, each adding fewer than N
+     * children; the master polls between rounds */
+    uint64_t expanded = 0;
+    size_t polls = 0;
+    for (;;) {
+        size_t k = size < batch ? size : batch;
+        if (size + k * N > cap) k = (cap - size) / N;
+        if (k == 0) break;
+
+        checkpoint_poll(NULL, 0, pool);
+        anytime_poll();
+        if ((polls += k) >= BOUND_UPDATE_INTERVAL) {
+            polls = 0;
+            poll_incumbent();
+            tt_exchange();
+        }
+        if (atomic_load(&anytime.stop) != STOP_NONE) break;
+
+        for (size_t i = 0; i < k; i++) heap_pop(heap, &size, &work[i]);
+
+        #ifdef _OPENMP
+        #pragma omp parallel for schedule(dynamic, 4) reduction(+:expanded) if (k > 1)
+        #endif
+        for (size_t i = 0; i < k; i++) {
+            kid_count[i] = best_first_expand(&work[i], &kids[i * N]);
+            if (kid_count[i] >= 0) expanded++;
+        }
+
+        for (size_t i = 0; i < k; i++)
+            for (int c = 0; c < kid_count[i]; c++)
+                heap_push(heap, &size, &kids[i * N + c].n, &kids[i * N + c].path);
+    }
+    free(work);
+    free(kids);
+    free(kid_count);
+    STAT(stats.total.expanded += expanded;)
+
+    /* What is left becomes the pool, least bound first; after a stop the
+     * DFS only drops it, so the order does not matter */
+    int best = __atomic_load_n(best_cost, __ATOMIC_RELAXED);
+    const int sorted = atomic_load(&anytime.stop) == STOP_NONE;
+    HeapKey *key = malloc((size + 1) * sizeof(HeapKey));
+    if (!key) { perror("malloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+    size_t live = 0;
+    for (size_t i = 0; i < size; i++)
+        if (!sorted || heap[i].n.bound < best)
+            key[live++] = (HeapKey){ heap[i].n.bound, heap[i].n.depth, i };
+    if (sorted) sort_heap_keys(key, live);
+
+    free(pool->tasks);
+    pool->tasks = malloc((live + 1) * sizeof(Task));
+    if (!pool->tasks) { perror("malloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif
+    for (size_t i = 0; i < live; i++)
+        node_to_task(&heap[key[i].index].n, &heap[key[i].index].path, &pool->tasks[i]);
+    pool->count = (int)live;
+
+    if (steal.rank == 0 && !quiet) {
+        printf("Best-first: %llu nodes expanded, %d DFS roots", (unsigned long long)expanded,
+               pool->count);
+        if (live > 0 && sorted)
+            printf(" (bounds %d-%d)", key[0].bound, key[live - 1].bound);
+        printf(", incumbent %d (%.3f s)\n", best, wall_time() - t0);
+    }
+    free(key);
+    free(heap);
+}
+
+typedef struct {
+    Task task;
+    int lb;                 /* 2-edge chain */
+    int bound;              /* sort key: strongest bound */
+} SeedEntry;
+
+static int compare_seed_lb(const void *a, const void *b)
+{
+    int la = ((const SeedEntry *)a)->bound, lb = ((const SeedEntry *)b)->bound;
+    return (la > lb) - (la < lb);
+}
+
+/* Expand the tree breadth-first from city 0, one full level at a time,
+ * until max_depth is reached or the frontier holds at least target
+ * prefixes.  Prefixes whose bound cannot beat best_path_cost are
+ * dropped on the way.  The result is ordered by lower bound so the most
+ * promising prefixes are searched first. */
+static Task *generate_seed_tasks(int max_depth, int target, int *count)
+{
+    if (max_depth > N - 1) max_depth = N - 1;
+    if (max_depth < 1) max_depth = 1;
+
+    /* Peers on the node may already be lowering the shared incumbent, so
+     * prune with this rank's own tour: every rank must build one pool */
+    const int ub = best_path_cost;
+
+    SeedEntry *level = malloc(sizeof(SeedEntry));
+    if (!level) { perror("malloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+    level[0].task = (Task){ .depth = 1, .cost = 0, .city = 0, .visitedMask = 1 };
+    level[0].lb = level[0].bound = lower_bound_2edge(0, 1);
+    int size = 1;
+
+    for (int depth = 1; depth < max_depth && (depth < 2 || size < target); depth++) {
+        SeedEntry *next = malloc((size_t)size * (N - depth) * sizeof(SeedEntry));
+        if (!next) { perror("malloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+        int next_size = 0;
+
+        for (int i = 0; i < size; i++) {
+            const Task *t = &level[i].task;
+            mask_t unvisited = ~t->visitedMask & all_cities;
+            while (unvisited) {
+                int city = __builtin_ctzll(unvisited);
+                unvisited &= unvisited - 1;
+
+                int cost = t->cost + DIST(t->city, city);
+                int lb = incremental_lower_bound(level[i].lb, t->city, city, N);
+                if (cost >= ub || lb >= ub) continue;
+
+                mask_t mask = t->visitedMask | ((mask_t)1 << city);
+                if (symmetric && !orientation_ok(mask, city, depth == 1 ? city : t->path.city[1]))
+                    continue;
+                int bound = node_bound(lb, cost, city, mask, depth + 1);
+                if (bound >= ub) continue;
+
+                SeedEntry *e = &next[next_size++];
+                e->task = *t;
+                e->task.depth = depth + 1;
+                e->task.cost = cost;
+                e->task.city = city;
+                e->task.visitedMask |= (mask_t)1 << city;
+                e->task.path.city[depth] = (uint8_t)city;
+                e->lb = lb;
+                e->bound = bound;
+            }
+        }
+
+        free(level);
+        level = next;
+        size = next_size;
+    }
+
+    qsort(level, size, sizeof(SeedEntry), compare_seed_lb);
+
+    Task *tasks = malloc((size > 0 ? size : 1) * sizeof(Task));
+    if (!tasks) { perror("malloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+    for (int i = 0; i < size; i++) tasks[i] = level[i].task;
+    free(level);
+
+    *count = size;
+    return tasks;
+}
+
+/* --------------------------------------------------------------------
+ *  Work estimates for seeding.  Knuth's estimator dives from a seed to a
+ *  leaf picking one surviving child uniformly at random; the sum of the
+ *  running products of the branching factors met is an unbiased guess
+ *  at the node count below the seed.  Each rank probes every world-th
+ *  seed and the sums are combined, so all ranks see the same estimates
+ *  and deal identical shares: longest first, each to the least loaded
+ *  rank (LPT).  Threads then claim a rank's share in that order.
+ * --------------------------------------------------------------------*/
+static double estimate_subtree(const Task *t, int ub, int probes, unsigned seed)
+{
+    double sum = 0;
+    for (int p = 0; p < probes; p++) {
+        Node n;
+        task_to_node(t, &n);
+        double weight = 1, size = 1;
+
+        while (n.depth < N) {
+            mask_t live = surviving_children(&n, ub, N);
+            int k = __builtin_popcountll(live);
+            if (k == 0) break;
+            weight *= k;
+            size += weight;
+
+            seed = seed * 1103515245u + 12345u;
+            for (int pick = (int)((seed >> 16) % (unsigned)k); pick > 0; pick--)
+                live &= live - 1;
+            int next = __builtin_ctzll(live);
+
+            n.parent_lb = incremental_lower_bound(n.parent_lb, n.city, next, N);
+            n.cost += DIST(n.city, next);
+            n.visitedMask |= (mask_t)1 << next;
+            if (n.depth == 1) n.first = (uint8_t)next;
+            n.city = (uint8_t)next;
+            n.depth++;
+        }
+        sum += size;
+    }
+    return sum / probes;
+}
+
+typedef struct {
+    double size;
+    int index;
+} SeedEstimate;
+
+/* Largest first; ties keep the bound order */
+static int compare_estimate(const void *a, const void *b)
+{
+    const SeedEstimate *x = a, *y = b;
+    if (x->size != y->size) return x->size < y->size ? 1 : -1;
+    return x->index - y->index;
+}
+
+/* Copy this rank's LPT share of tasks[0..total) into pool, largest first */
+static void deal_by_estimate(const Task *tasks, int total, int rank, int world,
+                             TaskPool *pool)
+{
+    double *est = calloc(total + 1, sizeof(double));
+    SeedEstimate *order = malloc((total + 1) * sizeof(SeedEstimate));
+    double *load = calloc(world, sizeof(double));
+    if (!est || !order || !load) { perror("malloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+
+    double t0 = MPI_Wtime();
+    for (int i = rank; i < total; i += world)
+        est[i] = estimate_subtree(&tasks[i], best_path_cost, opts.probes,
+                                  0x9e3779b9u ^ (unsigned)i);
+    MPI_Allreduce(MPI_IN_PLACE, est, total, MPI_DOUBLE, MPI_SUM, comm);
+
+    for (int i = 0; i < total; i++) order[i] = (SeedEstimate){ est[i], i };
+    qsort(order, total, sizeof(SeedEstimate), compare_estimate);
+
+    double sum = 0;
+    for (int q = 0; q < total; q++) {
+        int target = 0;
+        for (int r = 1; r < world; r++)
+            if (load[r] < load[target]) target = r;
+        load[target] += order[q].size;
+        sum += order[q].size;
+        if (target == rank) pool->tasks[pool->count++] = tasks[order[q].index];
+    }
+
+    if (rank == 0 && !quiet) {
+        double max = 0;
+        for (int r = 0; r < world; r++)
+            if (load[r] > max) max = load[r];
+        printf("Work estimate: %d probes per seed, %.3g nodes, max/mean rank load %.2f (%.3f s)\n",
+               opts.probes, sum, sum > 0 ? max * world / sum : 1.0, MPI_Wtime() - t0);
+    }
+    free(est);
+    free(order);
+    free(load);
+}
+
+/* --------------------------------------------------------------------
+ *  Warm start: nearest-neighbour tours from several start cities, each
+ *  polished by 2-opt and Or-opt, give the search a finite incumbent
+ *  before the first leaf is reached.  Tours are kept rotated so city 0
+ *  comes first; moves never touch position 0.  The matrix may be
+ *  asymmetric, so 2-opt prices the reversed segment from prefix sums
+ *  in both directions.
+ * --------------------------------------------------------------------*/
+static int tour_length(const int *t)
+{
+    int cost = DIST(t[N - 1], t[0]);
+    for (int i = 0; i + 1 < N; i++) cost += DIST(t[i], t[i + 1]);
+    return cost;
+}
+
+static void nearest_neighbour_tour(int start, int *t)
+{
+    int tour[MAX_N];
+    mask_t left = all_cities & ~((mask_t)1 << start);
+    tour[0] = start;
+    for (int i = 1; i < N; i++) {
+        int from = tour[i - 1], next = -1;
+        for (mask_t m = left; m; m &= m - 1) {
+            int c = __builtin_ctzll(m);
+            if (next < 0 || DIST(from, c) < DIST(from, next)) next = c;
+        }
+        tour[i] = next;
+        left &= ~((mask_t)1 << next);
+    }
+
+    int zero = 0;
+    while (tour[zero] != 0) zero++;
+    for (int i = 0; i < N; i++) t[i] = tour[(zero + i) % N];
+}
+
+/* One improving 2-opt move, first found; returns 1 if applied */
+static int two_opt_pass(int *t)
+{
+    int fwd[MAX_N], bwd[MAX_N];
+    fwd[0] = bwd[0] = 0;
+    for (int k = 0; k + 1 < N; k++) {
+        fwd[k + 1] = fwd[k] + DIST(t[k], t[k + 1]);
+        bwd[k + 1] = bwd[k] + DIST(t[k + 1], t[k]);
+    }
+
+    for (int i = 1; i < N - 1; i++) {
+        for (int j = i + 1; j < N; j++) {
+            int a = t[i - 1], e = t[(j + 1) % N];
+            int delta = DIST(a, t[j]) + DIST(t[i], e) - DIST(a, t[i]) - DIST(t[j], e)
+                      + (bwd[j] - bwd[i]) - (fwd[j] - fwd[i]);
+            if (delta < 0) {
+                for (int l = i, r = j; l < r; l++, r--) {
+                    int tmp = t[l]; t[l] = t[r]; t[r] = tmp;
+                }
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* One improving Or-opt move: relocate a run of 1-3 cities */
+static int or_opt_pass(int *t)
+{
+    for (int len = 1; len <= 3 && len < N - 1; len++) {
+        for (int i = 1; i + len <= N; i++) {
+            int p = t[i - 1], s0 = t[i], s1 = t[i + len - 1], nx = t[(i + len) % N];
+            int gain = DIST(p, s0) + DIST(s1, nx) - DIST(p, nx);
+
+            for (int k = 0; k < N; k++) {
+                if (k >= i - 1 && k <= i + len - 1) continue;
+                int u = t[k], v = t[(k + 1) % N];
+                if (DIST(u, s0) + DIST(s1, v) - DIST(u, v) >= gain) continue;
+
+                int out[MAX_N], n = 0;
+                for (int q = 0; q < N; q++) {
+                    if (q >= i && q < i + len) continue;
+                    out[n++] = t[q];
+                    if (q == k)
+                        for (int r = 0; r < len; r++) out[n++] = t[i + r];
+                }
+                memcpy(t, out, N * sizeof(int));
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void warm_start(int rank, int world)
+{
+    if (N < 2) return;
+
+    int best[MAX_N], tour[MAX_N];
+    int mine = INT_MAX, starts = 0;
+
+    /* Start cities are dealt round-robin; rank r tries r, r+world, ... */
+    for (int s = rank % N; s < N; s += world) {
+        nearest_neighbour_tour(s, tour);
+        while (two_opt_pass(tour) || or_opt_pass(tour)) ;
+        int cost = tour_length(tour);
+        if (cost < mine) { mine = cost; memcpy(best, tour, sizeof(tour)); }
+        starts++;
+    }
+    if (starts == 0) {   /* more ranks than cities: repeat a start */
+        nearest_neighbour_tour(rank % N, best);
+        while (two_opt_pass(best) || or_opt_pass(best)) ;
+        mine = tour_length(best);
+    }
+
+    struct { int cost, rank; } in = { mine, rank }, out;
+    MPI_Allreduce(&in, &out, 1, MPI_2INT, MPI_MINLOC, comm);
+    MPI_Bcast(best, N, MPI_INT, out.rank, comm);
+
+    incumbent_lower(out.cost);
+    best_path_cost = out.cost;
+    memcpy(best_path, best, N * sizeof(int));
+    best_path[N] = 0;
+    stats_tour();
+
+    if (rank == 0 && !quiet)
+        printf("Warm start: tour of %d from %d start cities (nearest neighbour + 2-opt/Or-opt)\n",
+               out.cost, N);
+}
+
+/* Stable distributed search */
+static void stable_distributed_search(int rank, int world)
+{
+    #ifdef _OPENMP
+    int threads = omp_get_max_threads();
+    #else
+    int threads = 1;
+    #endif
+
+    if (!opts.no_warm_start) warm_start(rank, world);
+
+    int root_bound = 0;
+    if (opts.bound == BOUND_1TREE) root_bound = onetree_init();
+    else onetree.depth = 0;
+
+    int root_2edge = lower_bound_2edge(0, (mask_t)1);
+    anytime.root_bound = root_bound > root_2edge ? root_bound : root_2edge;
+    anytime.active = opts.time_limit > 0 || opts.gap >= 0;
+    if (opts.time_limit > 0) anytime.deadline = anytime.t0 + opts.time_limit;
+
+    int max_depth = opts.seed_depth ? opts.seed_depth : N - 1;
+    int target = opts.seed_tasks ? opts.seed_tasks
+               : opts.seed_depth ? INT_MAX
+               : SEED_TASKS_PER_THREAD * world * threads;
+
+    /* Every rank builds the same pool and keeps every world-th task, or
+     * its share by estimated work */
+    int total_tasks = 0;
+    Task *all_tasks = opts.restart ? checkpoint_load(rank, &total_tasks)
+                                   : generate_seed_tasks(max_depth, target, &total_tasks);
+
+    /* An LPT share can hold any number of tasks */
+    int capacity = opts.probes ? total_tasks + 1 : total_tasks / world + 1;
+
+    TaskPool pool = { .tasks = malloc(capacity * sizeof(Task)) };
+    if (!pool.tasks) { perror("malloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+    if (opts.probes) {
+        deal_by_estimate(all_tasks, total_tasks, rank, world, &pool);
+    } else {
+        for (int i = rank; i < total_tasks; i += world)
+            pool.tasks[pool.count++] = all_tasks[i];
+    }
+
+    if (rank == 0 && !quiet) {
+        printf("Stable hybrid search: %d ranks, %d seed tasks (depth %d), %d-%d tasks per rank",
+               world, total_tasks, total_tasks ? all_tasks[0].depth : 0,
+               total_tasks / world, (total_tasks + world - 1) / world);
+        #ifdef _OPENMP
+        printf(", %d OpenMP threads per rank\n", threads);
+        #else
+        printf(", 1 thread per rank\n");
+        #endif
+        if (symmetric)
+            printf("Symmetric matrix: searching one orientation of each tour\n");
+        if (bounds->directed)
+            printf("Asymmetric matrix: 2-edge bound from cheapest edges out and in\n");
+        if (opts.bound == BOUND_1TREE)
+            printf("1-tree bound: root %d, applied to depth %d\n", root_bound, onetree.depth);
+    }
+    free(all_tasks);
+    
+    steal = (StealState){
+        .rank = rank,
+        .world = world,
+        .color = WHITE,
+        .have_token = (rank == 0),
+        .token_color = WHITE,
+        .seed = 0x9e3779b9u ^ (unsigned)rank
+    };
+
+    /* Search own share; idle threads steal locally, then from peers */
+    if (opts.tt_mb) tt_init(rank);
+    suffix_init(rank);
+    ckpt.next = MPI_Wtime() + opts.checkpoint_interval;
+    best_first_phase(&pool);
+    stable_hybrid_dfs(&pool);
+
+    if (world > 1) steal_shutdown();
+    checkpoint_finish();
+    tt_free();
+    suffix_free();
+    free(pool.tasks);
+    free(onetree.w);
+    onetree.w = NULL;
+}
+
+/* Row stride and city mask for the current N */
+static void matrix_geometry(void)
+{
+    dist_stride = STRIDE_OF(N);
+    all_cities = CITIES_OF(N);
+}
+
+/* Zeroed N x N matrix whose rows start on cache-line boundaries */
+static void alloc_distance_matrix(void)
+{
+    matrix_geometry();
+    size_t bytes = (size_t)N * dist_stride * sizeof(int);
+
+    dist = aligned_alloc(DIST_ALIGN * sizeof(int), bytes);
+    if (!dist) { perror("aligned_alloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+    memset(dist, 0, bytes);
+}
+
+/* Move the node leader's private matrix into node-shared memory after
+ * the incumbent and the bound tables, which the leader then fills in.
+ * Collective over node.comm. */
+static void share_instance(void)
+{
+    MPI_Bcast(&N, 1, MPI_INT, 0, node.comm);
+    matrix_geometry();
+
+    size_t bytes = (size_t)N * dist_stride * sizeof(int);
+    NodeInstance *inst = node_alloc(sizeof(NodeInstance) + bytes, &node.win);
+    int *shared = (int *)(inst + 1);
+
+    if (node.rank == 0) {
+        memcpy(shared, dist, bytes);
+        free(dist);
+    }
+    dist = shared;
+    bounds = &inst->bounds;
+    best_cost = &inst->incumbent;
+
+    if (node.rank == 0) {
+        precompute_enhanced_bounds();
+        *best_cost = INT_MAX;
+    }
+    node_sync(node.win);
+}
+
+/* --------------------------------------------------------------------
+ *  Held-Karp engine: dp(S, j) = cheapest path 0 -> S -> j over every
+ *  subset S of cities 1..N-1.  City c is bit c-1 of S.  Subsets are stored
+ *  level by level (|S| = k), in colex order inside a level, each with k
+ *  entries - one per member j in ascending order.  Level k only reads
+ *  level k-1 and writes its own block sequentially, so levels are split
+ *  into contiguous slices across ranks (then allgathered) and threads.
+ * --------------------------------------------------------------------*/
+/* Fill dp for subsets [lo, hi) of level k */
+static void hk_level_range(int *dp, const size_t *level_ofs, int k, int m,
+                           uint64_t lo, uint64_t hi)
+{
+    const int *prev = dp + level_ofs[k - 1];
+    int *cur = dp + level_ofs[k];
+    uint64_t S = subset_unrank(lo, k, m);
+
+    for (uint64_t r = lo; r < hi; r++, S = next_subset(S)) {
+        int member[HK_MAX_N];
+        uint64_t pre[HK_MAX_N + 1], suf[HK_MAX_N + 1];
+
+        uint64_t bits = S;
+        for (int q = 0; q < k; q++) {
+            member[q] = __builtin_ctzll(bits);
+            bits &= bits - 1;
+        }
+
+        /* rank(S \ member[q]) = pre[q] + suf[q + 1] */
+        pre[0] = 0;
+        for (int q = 0; q < k; q++) pre[q + 1] = pre[q] + binom[member[q]][q + 1];
+        suf[k] = 0;
+        for (int q = k - 1; q >= 0; q--) suf[q] = suf[q + 1] + binom[member[q]][q];
+
+        int *out = cur + r * k;
+        for (int q = 0; q < k; q++) {
+            const int *sub = prev + (pre[q] + suf[q + 1]) * (k - 1);
+            const int j = member[q] + 1;
+            int best = INT_MAX;
+
+            for (int i = 0; i < k; i++) {
+                if (i == q) continue;
+                int c = sub[i < q ? i : i - 1] + DIST(member[i] + 1, j);
+                if (c < best) best = c;
+            }
+            out[q] = best;
+        }
+    }
+}
+
+static void held_karp_search(int rank, int world)
+{
+    if (N > HK_MAX_N) {
+        if (rank == 0)
+            fprintf(stderr, "Held-Karp engine supports at most %d cities\n", HK_MAX_N);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    if (N == 1) {
+        incumbent_lower(0);
+        best_path_cost = 0;
+        best_path[0] = best_path[1] = 0;
+        return;
+    }
+
+    const int m = N - 1;
+    init_binomials(m);
+
+    size_t level_ofs[HK_MAX_N + 1];
+    level_ofs[0] = level_ofs[1] = 0;
+    for (int k = 1; k < m; k++)
+        level_ofs[k + 1] = level_ofs[k] + binom[m][k] * k;
+    size_t entries = level_ofs[m] + (size_t)m;
+
+    if (rank == 0 && !quiet) {
+        printf("Held-Karp DP: %d ranks, %.1f MB table", world,
+               entries * sizeof(int) / 1048576.0);
+        #ifdef _OPENMP
+        printf(", %d OpenMP threads per rank\n", omp_get_max_threads());
+        #else
+        printf(", 1 thread per rank\n");
+        #endif
+    }
+
+    /* Each level is first touched by the threads that fill it */
+    int *dp = huge_alloc(entries * sizeof(int));
+    if (!dp) {
+        fprintf(stderr, "rank %d: cannot allocate %.1f MB Held-Karp table\n",
+                rank, entries * sizeof(int) / 1048576.0);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    /* Level 1: straight from city 0 */
+    for (int c = 0; c < m; c++) dp[level_ofs[1] + c] = DIST(0, c + 1);
+
+    int *counts = malloc(world * sizeof(int));
+    int *displs = malloc(world * sizeof(int));
+    if (!counts || !displs) { perror("malloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+
+    for (int k = 2; k <= m; k++) {
+        const uint64_t subsets = binom[m][k];
+        const uint64_t lo = subsets * rank / world;
+        const uint64_t hi = subsets * (rank + 1) / world;
+
+        #ifdef _OPENMP
+        #pragma omp parallel
+        {
+            const uint64_t n = hi - lo;
+            const int t = omp_get_thread_num(), nt = omp_get_num_threads();
+            hk_level_range(dp, level_ofs, k, m, lo + n * t / nt, lo + n * (t + 1) / nt);
+        }
+        #else
+        hk_level_range(dp, level_ofs, k, m, lo, hi);
+        #endif
+
+        if (world > 1) {
+            for (int r = 0; r < world; r++) {
+                displs[r] = (int)(subsets * r / world * k);
+                counts[r] = (int)(subsets * (r + 1) / world * k) - displs[r];
+            }
+            MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, dp + level_ofs[k],
+                           counts, displs, MPI_INT, comm);
+        }
+    }
+    free(counts);
+    free(displs);
+
+    /* Close the tour, then walk the table backwards to recover it */
+    const int *full = dp + level_ofs[m];
+    int last = 0;
+    best_path_cost = INT_MAX;
+    for (int q = 0; q < m; q++) {
+        int c = full[q] + DIST(q + 1, 0);
+        if (c < best_path_cost) { best_path_cost = c; last = q; }
+    }
+    incumbent_lower(best_path_cost);
+    stats_tour();
+
+    uint64_t S = ((uint64_t)1 << m) - 1;
+    int value = full[last];
+    best_path[N] = 0;
+    for (int k = m; k >= 1; k--) {
+        best_path[k] = last + 1;
+        if (k == 1) break;
+
+        uint64_t sub = S & ~((uint64_t)1 << last);
+        const int *row = dp + level_ofs[k - 1] + subset_rank(sub) * (k - 1);
+        int idx = 0;
+        for (uint64_t bits = sub; bits; bits &= bits - 1, idx++) {
+            int i = __builtin_ctzll(bits);
+            if (row[idx] + DIST(i + 1, last + 1) == value) {
+                value = row[idx];
+                last = i;
+                break;
+            }
+        }
+        S = sub;
+    }
+    best_path[0] = 0;
+
+    free(dp);
+}
+
+static void read_distance_file(const char *fname)
+{
+    FILE *fp = fopen(fname, "r");
+    if (!fp) { perror("open dist file"); MPI_Abort(MPI_COMM_WORLD, 1); }
+
+    if (fscanf(fp, "%d", &N) != 1 || N > MAX_N || N <= 0) {
+        fprintf(stderr, "Invalid N=%d in file (must be 1-%d)\n", N, MAX_N);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    alloc_distance_matrix();
+
+    /* Read one value past a full square matrix to reject oversized input */
+    const int needSquare = N * N;
+    const int needTri = N * (N - 1) / 2;
+
+    int *nums = malloc((needSquare + 1) * sizeof(int));
+    if (!nums) { perror("malloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+    int cnt = 0;
+    while (cnt <= needSquare && fscanf(fp, "%d", &nums[cnt]) == 1) ++cnt;
+    fclose(fp);
+
+    if (cnt == needSquare) {
+        for (int i = 0, k = 0; i < N; ++i)
+            for (int j = 0; j < N; ++j)
+                DIST(i, j) = nums[k++];
+    } else if (cnt == needTri) {
+        int k = 0;
+        for (int i = 1; i < N; ++i) {
+            for (int j = 0; j < i; ++j) {
+                DIST(i, j) = DIST(j, i) = nums[k++];
+            }
+        }
+    } else {
+        fprintf(stderr, "Unsupported format: %d ints read, need %d (square) or %d (triangular)\n", 
+                cnt, needSquare, needTri);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    free(nums);
+}
+
+/* Rank 0 tells the formats apart by their first bytes */
+static int detect_format(const char *fname)
+{
+    FILE *fp = fopen(fname, "r");
+    if (!fp) { perror("open dist file"); MPI_Abort(MPI_COMM_WORLD, 1); }
+
+    char head[4] = {0};
+    size_t got = fread(head, 1, sizeof(head), fp);
+    fclose(fp);
+
+    if (got == 4 && memcmp(head, "WSPB", 4) == 0) return FORMAT_BINARY;
+    if (got == 4 && memcmp(head, "City", 4) == 0) return FORMAT_COORDS;
+    return FORMAT_TEXT;
+}
+
+/* Every rank maps the file and copies rows into its padded matrix, so
+ * nothing is broadcast and the page cache is shared within a node */
+static void read_binary_file(const char *fname)
+{
+    int fd = open(fname, O_RDONLY);
+    if (fd < 0) { perror("open dist file"); MPI_Abort(MPI_COMM_WORLD, 1); }
+
+    struct stat sb;
+    if (fstat(fd, &sb) != 0) { perror("fstat"); MPI_Abort(MPI_COMM_WORLD, 1); }
+    if ((size_t)sb.st_size < sizeof(BinaryHeader)) {
+        fprintf(stderr, "%s: truncated binary header\n", fname);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    void *map = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) { perror("mmap"); MPI_Abort(MPI_COMM_WORLD, 1); }
+
+    const BinaryHeader *h = map;
+    if (h->version != 1 || h->n == 0 || h->n > MAX_N ||
+        (size_t)sb.st_size != sizeof(*h) + (size_t)h->n * h->n * sizeof(int32_t)) {
+        fprintf(stderr, "%s: bad binary instance (version %u, N=%u in %lld bytes; "
+                "N must be 1-%d)\n", fname, h->version, h->n, (long long)sb.st_size, MAX_N);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    N = (int)h->n;
+    alloc_distance_matrix();
+
+    const int32_t *rows = (const int32_t *)(h + 1);
+    for (int i = 0; i < N; i++)
+        memcpy(&DIST(i, 0), rows + (size_t)i * N, N * sizeof(int32_t));
+
+    munmap(map, sb.st_size);
+}
+
+/* floor(sqrt(v)) by binary search, matching distgen's (int) cast of the
+ * double root without linking libm */
+static int isqrt(long v)
+{
+    long lo = 0, hi = v;
+    while (lo < hi) {
+        long mid = lo + (hi - lo + 1) / 2;
+        if (mid <= v / mid) lo = mid; else hi = mid - 1;
+    }
+    return (int)lo;
+}
+
+/* "City k: (x, y)" lines as printed by distgen; every rank parses the
+ * file and computes the Euclidean distances itself */
+static void read_coordinate_file(const char *fname)
+{
+    FILE *fp = fopen(fname, "r");
+    if (!fp) { perror("open city file"); MPI_Abort(MPI_COMM_WORLD, 1); }
+
+    int x[MAX_N], y[MAX_N], seen[MAX_N] = {0};
+    int k, cx, cy, n = 0;
+    while (fscanf(fp, " City %d: ( %d , %d )", &k, &cx, &cy) == 3) {
+        if (k < 0 || k >= MAX_N || seen[k]) {
+            fprintf(stderr, "%s: bad or repeated city index %d (must be 0-%d)\n",
+                    fname, k, MAX_N - 1);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        x[k] = cx;
+        y[k] = cy;
+        seen[k] = 1;
+        if (k + 1 > n) n = k + 1;
+    }
+    int trailing = !feof(fp);
+    fclose(fp);
+
+    for (int i = 0; i < n; i++) {
+        if (!seen[i]) trailing = 1;
+    }
+    if (n == 0 || trailing) {
+        fprintf(stderr, "%s: expected lines \"City k: (x, y)\" for k = 0..N-1\n", fname);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    N = n;
+    alloc_distance_matrix();
+    for (int i = 0; i < N; i++)
+        for (int j = 0; j < N; j++) {
+            long dx = x[i] - x[j], dy = y[i] - y[j];
+            DIST(i, j) = isqrt(dx * dx + dy * dy);
+        }
+}
+
+/* Reduce the counters over `comm` and have rank 0 write them as JSON
+ * to opts.stats.  Collective. */
+static void stats_report(const char *fname, int global_best, double seconds)
+{
+    int rank, world;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &world);
+    #ifdef _OPENMP
+    int threads = omp_get_max_threads();
+    #else
+    int threads = 1;
+    #endif
+
+    SearchStats sum;
+    uint64_t high, thread_min, thread_max;
+    MPI_Reduce(&stats.total, &sum, STATS_FIELDS, MPI_UINT64_T, MPI_SUM, 0, comm);
+    MPI_Reduce(&stats.total.high_water, &high, 1, MPI_UINT64_T, MPI_MAX, 0, comm);
+    MPI_Reduce(&stats.thread_min, &thread_min, 1, MPI_UINT64_T, MPI_MIN, 0, comm);
+    MPI_Reduce(&stats.thread_max, &thread_max, 1, MPI_UINT64_T, MPI_MAX, 0, comm);
+
+    /* First tour found anywhere, and the first rank to reach the best */
+    double mine[2] = {
+        stats.first_tour < 0 ? 1e300 : stats.first_tour,
+        stats.best_tour < 0 || best_path_cost != global_best ? 1e300 : stats.best_tour
+    }, when[2];
+    MPI_Reduce(mine, when, 2, MPI_DOUBLE, MPI_MIN, 0, comm);
+
+    uint64_t *per_rank = rank == 0 ? malloc(world * sizeof(uint64_t)) : NULL;
+    if (rank == 0 && !per_rank) { perror("malloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+    MPI_Gather(&stats.total.expanded, 1, MPI_UINT64_T, per_rank, 1, MPI_UINT64_T, 0, comm);
+    if (rank != 0) return;
+
+    FILE *fp = strcmp(opts.stats, "-") == 0 ? stdout : fopen(opts.stats, "w");
+    if (!fp) { perror("open stats file"); MPI_Abort(MPI_COMM_WORLD, 1); }
+
+    fprintf(fp, "{\n  \"instance\": \"");
+    for (const char *c = fname; *c; c++)
+        fprintf(fp, *c == '"' || *c == '\\' ? "\\%c" : "%c", *c);
+    fprintf(fp, "\",\n  \"n\": %d,\n  \"engine\": \"%s\",\n  \"ranks\": %d,\n"
+            "  \"threads_per_rank\": %d,\n",
+            N, opts.engine == ENGINE_HK ? "hk" : "bb", world, threads);
+    if (global_best < INT_MAX) fprintf(fp, "  \"cost\": %d,\n", global_best);
+    else fprintf(fp, "  \"cost\": null,\n");
+    fprintf(fp, "  \"time_s\": %.6f,\n", seconds);
+    const char *names[2] = { "first_incumbent_s", "final_incumbent_s" };
+    for (int i = 0; i < 2; i++) {
+        if (when[i] < 1e300) fprintf(fp, "  \"%s\": %.6f,\n", names[i], when[i]);
+        else fprintf(fp, "  \"%s\": null,\n", names[i]);
+    }
+    fprintf(fp, "  \"nodes\": {\n"
+            "    \"expanded\": %llu,\n"
+            "    \"pruned_cost\": %llu,\n"
+            "    \"pruned_bound\": %llu,\n"
+            "    \"pruned_child\": %llu,\n"
+            "    \"pruned_closing\": %llu,\n"
+            "    \"dominated\": %llu,\n"
+            "    \"suffix_finished\": %llu,\n"
+            "    \"spilled\": %llu\n"
+            "  },\n",
+            (unsigned long long)sum.expanded, (unsigned long long)sum.pruned_cost,
+            (unsigned long long)sum.pruned_bound, (unsigned long long)sum.pruned_child,
+            (unsigned long long)sum.pruned_closing, (unsigned long long)sum.dominated,
+            (unsigned long long)sum.suffix, (unsigned long long)sum.spilled);
+    if (thread_min > thread_max) thread_min = thread_max = 0;   /* no DFS ran */
+    fprintf(fp, "  \"stack_high_water\": %llu,\n"
+            "  \"expanded_per_thread\": { \"min\": %llu, \"mean\": %.1f, \"max\": %llu },\n"
+            "  \"expanded_per_rank\": [",
+            (unsigned long long)high, (unsigned long long)thread_min,
+            (double)sum.expanded / ((double)world * threads), (unsigned long long)thread_max);
+    for (int r = 0; r < world; r++)
+        fprintf(fp, "%s%llu", r ? ", " : "", (unsigned long long)per_rank[r]);
+    fprintf(fp, "]\n}\n");
+
+    if (fp != stdout) fclose(fp);
+    free(per_rank);
+}
+
+/* Allocate a ring for every thread the search will run and start the
+ * clock.  Does nothing unless --trace is set. */
+static void trace_init(double t0)
+{
+    if (!opts.trace) return;
+    #ifdef _OPENMP
+    trace.threads = omp_get_max_threads();
+    #else
+    trace.threads = 1;
+    #endif
+    trace.t0 = t0;
+    trace.rings = calloc(trace.threads, sizeof(TraceRing));
+    if (!trace.rings) { perror("calloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+    for (int t = 0; t < trace.threads; t++) {
+        trace.rings[t].events = malloc(TRACE_EVENTS * sizeof(TraceEvent));
+        if (!trace.rings[t].events) { perror("malloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+    }
+}
+
+/* Names of each kind and of its two arguments (NULL = not shown) */
+static const struct { const char *name, *arg, *peer; } trace_kinds[TRACE_KINDS] = {
+    [TR_TASK]         = { "task", "seed", NULL },
+    [TR_FIND_WORK]    = { "find work", "found", NULL },
+    [TR_STEAL]        = { "steal", "stolen", "victim" },
+    [TR_STEAL_REMOTE] = { "steal request", "tasks", "victim" },
+    [TR_SERVE]        = { "serve steal", "tasks", "thief" },
+    [TR_INCUMBENT]    = { "incumbent", "cost", NULL },
+    [TR_EXCHANGE]     = { "bound exchange", "global", NULL },
+    [TR_GATHER]       = { "gather", "cost", NULL },
+};
+
+static void trace_print(FILE *fp, int rank, const TraceEvent *e, int *first)
+{
+    fprintf(fp, "%s\n{\"name\": \"%s\", \"cat\": \"wsp\", \"pid\": %d, \"tid\": %d, "
+            "\"ts\": %.3f, ", *first ? "" : ",", trace_kinds[e->kind].name, rank,
+            e->thread, 1e6 * e->start);
+    if (e->dur < 0) fprintf(fp, "\"ph\": \"i\", \"s\": \"t\", ");
+    else fprintf(fp, "\"ph\": \"X\", \"dur\": %.3f, ", 1e6 * e->dur);
+    fprintf(fp, "\"args\": {\"%s\": %d", trace_kinds[e->kind].arg, e->arg);
+    if (trace_kinds[e->kind].peer)
+        fprintf(fp, ", \"%s\": %d", trace_kinds[e->kind].peer, e->peer);
+    fprintf(fp, "}}");
+    *first = 0;
+}
+
+/* Send every ring to rank 0 of `comm`, which writes them all to
+ * opts.trace, then free the rings.  Collective. */
+static void trace_write(const char *fname)
+{
+    if (!trace.rings) return;
+
+    int rank, world;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &world);
+
+    /* Each ring's surviving events, oldest first */
+    uint64_t kept = 0, lost = 0;
+    for (int t = 0; t < trace.threads; t++) {
+        uint64_t c = trace.rings[t].count;
+        kept += c < TRACE_EVENTS ? c : TRACE_EVENTS;
+        lost += c < TRACE_EVENTS ? 0 : c - TRACE_EVENTS;
+    }
+    TraceEvent *mine = malloc((kept + 1) * sizeof(TraceEvent));
+    if (!mine) { perror("malloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+    uint64_t k = 0;
+    for (int t = 0; t < trace.threads; t++) {
+        const TraceRing *r = &trace.rings[t];
+        uint64_t from = r->count < TRACE_EVENTS ? 0 : r->count - TRACE_EVENTS;
+        for (uint64_t i = from; i < r->count; i++) mine[k++] = r->events[i % TRACE_EVENTS];
+        free(r->events);
+    }
+    free(trace.rings);
+    trace.rings = NULL;
+
+    uint64_t total_lost;
+    MPI_Reduce(&lost, &total_lost, 1, MPI_UINT64_T, MPI_SUM, 0, comm);
+
+    int header[2] = { trace.threads, (int)kept };
+    if (rank != 0) {
+        MPI_Send(header, 2, MPI_INT, 0, TAG_TRACE, comm);
+        MPI_Send(mine, (int)(kept * sizeof(TraceEvent)), MPI_BYTE, 0, TAG_TRACE, comm);
+        free(mine);
+        return;
+    }
+
+    FILE *fp = fopen(opts.trace, "w");
+    if (!fp) { perror("open trace file"); MPI_Abort(MPI_COMM_WORLD, 1); }
+    fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"otherData\": {\"instance\": \"");
+    for (const char *c = fname; *c; c++)
+        fprintf(fp, *c == '"' || *c == '\\' ? "\\%c" : "%c", *c);
+    fprintf(fp, "\", \"ranks\": %d, \"overwritten\": %llu},\n\"traceEvents\": [",
+            world, (unsigned long long)total_lost);
+
+    int first = 1;
+    for (int r = 0; r < world; r++) {
+        TraceEvent *ev = mine;
+        if (r > 0) {
+            MPI_Recv(header, 2, MPI_INT, r, TAG_TRACE, comm, MPI_STATUS_IGNORE);
+            ev = malloc(((size_t)header[1] + 1) * sizeof(TraceEvent));
+            if (!ev) { perror("malloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+            MPI_Recv(ev, (int)(header[1] * sizeof(TraceEvent)), MPI_BYTE, r, TAG_TRACE,
+                     comm, MPI_STATUS_IGNORE);
+        }
+        fprintf(fp, "%s\n{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, "
+                "\"args\": {\"name\": \"rank %d\"}}", first ? "" : ",", r, r);
+        first = 0;
+        for (int t = 0; t < header[0]; t++)
+            fprintf(fp, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, "
+                    "\"tid\": %d, \"args\": {\"name\": \"thread %d\"}}", r, t, t);
+        for (int i = 0; i < header[1]; i++) trace_print(fp, r, &ev[i], &first);
+        free(ev);
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+}
+
+/* Best tour of one instance, valid on rank 0 of `comm` */
+typedef struct {
+    int cost;                   /* INT_MAX when no tour was found */
+    int bound;                  /* proven lower bound; == cost if optimal */
+    int stopped;                /* STOP_* that ended an anytime run */
+    int path[MAX_PATH + 1];
+    double seconds;             /* search plus gather, excluding input */
+} SolveResult;
+
+/* Read `fname` into a private matrix on every node leader.  Collective
+ * over node.leaders. */
+static void load_instance(const char *fname)
+{
+    int rank;
+    MPI_Comm_rank(node.leaders, &rank);
+
+    int format = FORMAT_TEXT;
+    if (rank == 0) format = detect_format(fname);
+    MPI_Bcast(&format, 1, MPI_INT, 0, node.leaders);
+
+    if (format == FORMAT_BINARY) {
+        read_binary_file(fname);
+    } else if (format == FORMAT_COORDS) {
+        read_coordinate_file(fname);
+    } else {
+        if (rank == 0) read_distance_file(fname);
+
+        MPI_Bcast(&N, 1, MPI_INT, 0, node.leaders);
+        if (rank != 0) alloc_distance_matrix();
+
+        /* Ship only the N x N payload, skipping the row padding */
+        MPI_Datatype rows;
+        MPI_Type_vector(N, N, dist_stride, MPI_INT, &rows);
+        MPI_Type_commit(&rows);
+        MPI_Bcast(dist, 1, rows, 0, node.leaders);
+        MPI_Type_free(&rows);
+    }
+}
+
+/* Load `fname` once per node, search it on every rank of `comm` and
+ * gather the best tour to comm rank 0.  Collective over `comm`; all
+ * per-instance state is rebuilt here, so batch mode calls it once per
+ * manifest entry. */
+static void solve_instance(const char *fname, SolveResult *res)
+{
+    int rank, world;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &world);
+
+    int own_node = node.comm == MPI_COMM_NULL;
+    if (own_node) node_init();
+
+    /* Matrix and enhanced bound precomputation, once per node */
+    if (node.rank == 0) load_instance(fname);
+    share_instance();
+
+    /* With d(i,j) == d(j,i) a tour and its mirror cost the same */
+    symmetric = !opts.no_symmetry && N >= 3 && !bounds->directed;
+
+    best_path_cost = INT_MAX;
+    memset(best_path, 0, sizeof(best_path));
+
+    int own_window = node.nodes > 1 && node.rank == 0 && incumbent.win == MPI_WIN_NULL;
+    if (own_window) incumbent_init();
+    else incumbent_reset();
+
+    stats = (RankStats){ .thread_min = UINT64_MAX, .t0 = wall_time(),
+                         .first_tour = -1, .best_tour = -1 };
+    anytime = (AnytimeState){ .t0 = stats.t0, .reported = INT_MAX, .rank = rank,
+                              .floor = INT_MAX };
+    trace_init(stats.t0);
+    double t0 = MPI_Wtime();
+
+    /* Run stable hybrid search, or the exact DP engine */
+    if (opts.engine == ENGINE_HK)
+        held_karp_search(rank, world);
+    else
+        stable_distributed_search(rank, world);
+
+    if (own_window) incumbent_free();
+
+    /* Synchronize results; only a rank holding the tour reports its cost */
+    TRACE(double gather_start = trace.rings ? trace_now() : 0;)
+    int global_best;
+    MPI_Allreduce(&best_path_cost, &global_best, 1, MPI_INT, MPI_MIN, comm);
+
+    /* An early stop proves only the least bound left unexplored */
+    int stop_info[2] = { anytime.floor, -atomic_load(&anytime.stop) }, stopped[2];
+    MPI_Allreduce(stop_info, stopped, 2, MPI_INT, MPI_MIN, comm);
+    int proven = stopped[0] < global_best ? stopped[0] : global_best;
+    if (proven < anytime.root_bound) proven = anytime.root_bound;
+    if (proven > global_best) proven = global_best;
 
     /* Collect the optimal path from whichever rank found it */
     int best_path_to_show[MAX_PATH + 1];
     memset(best_path_to_show, 0, sizeof(best_path_to_show));
     
     if (rank == 0) {
-        if (best_cost == global_best) {
+        if (best_path_cost == global_best) {
             memcpy(best_path_to_show, best_path, (N + 1) * sizeof(int));
         }
         
@@ -361,32 +3616,894 @@ int main(int argc, char **argv)
             int their_cost;
             int their_path[MAX_PATH + 1];
             
-            MPI_Recv(&their_cost, 1, MPI_INT, src, 99, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            MPI_Recv(&their_cost, 1, MPI_INT, src, 99, comm, MPI_STATUS_IGNORE);
             if (their_cost == global_best) {
-                MPI_Recv(their_path, N + 1, MPI_INT, src, 100, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                MPI_Recv(their_path, N + 1, MPI_INT, src, 100, comm, MPI_STATUS_IGNORE);
                 memcpy(best_path_to_show, their_path, (N + 1) * sizeof(int));
             } else {
-                MPI_Recv(their_path, N + 1, MPI_INT, src, 100, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                MPI_Recv(their_path, N + 1, MPI_INT, src, 100, comm, MPI_STATUS_IGNORE);
             }
         }
     } else {
-        MPI_Send(&best_cost, 1, MPI_INT, 0, 99, MPI_COMM_WORLD);
-        MPI_Send(best_path, N + 1, MPI_INT, 0, 100, MPI_COMM_WORLD);
+        MPI_Send(&best_path_cost, 1, MPI_INT, 0, 99, comm);
+        MPI_Send(best_path, N + 1, MPI_INT, 0, 100, comm);
     }
 
     double t1 = MPI_Wtime();
+    TRACE(trace_span(TR_GATHER, gather_start, global_best, -1);)
+
+    if (opts.stats) stats_report(fname, global_best, t1 - t0);
+    trace_write(fname);
 
     if (rank == 0) {
-        printf("Optimal tour cost: %d   time: %.3f s   ranks: %d\n",
-               global_best, t1 - t0, world);
-        
-        if (global_best < INT_MAX) {
-            printf("Optimal path: ");
+        /* Report the canonical orientation: path[1] < path[N-1] */
+        if (global_best < INT_MAX && symmetric &&
+            best_path_to_show[1] > best_path_to_show[N - 1]) {
+            for (int l = 1, r = N - 1; l < r; l++, r--) {
+                int tmp = best_path_to_show[l];
+                best_path_to_show[l] = best_path_to_show[r];
+                best_path_to_show[r] = tmp;
+            }
+        }
+        res->cost = global_best;
+        res->bound = proven;
+        res->stopped = -stopped[1];
+        res->seconds = t1 - t0;
+        memcpy(res->path, best_path_to_show, (N + 1) * sizeof(int));
+    }
+
+    node_release(&node.win);
+    dist = NULL;
+    bounds = NULL;
+    best_cost = NULL;
+    if (own_node) node_free();
+}
+
+/* --------------------------------------------------------------------
+ *  Batch mode: every instance of a manifest in one job.  Instances are
+ *  binned by N into classes solved by groups of 1, 2, 4 or 8 ranks, and
+ *  the world is split once into groups, dealt to the classes in
+ *  proportion to their estimated work (N^2 2^N per instance).  Group
+ *  leaders claim instances from a per-class counter on world rank 0,
+ *  moving on to the other classes once their own is drained, and append
+ *  one line per solved instance to the shared results file.
+ * --------------------------------------------------------------------*/
+typedef struct {
+    int count;
+    int *n;                     /* city count per instance */
+    char (*name)[FILE_NAME_MAX];
+} Manifest;
+
+/* Rank 0 peeks at an instance's city count without loading it */
+static int instance_size(const char *fname)
+{
+    int n = 0;
+    int format = detect_format(fname);
+    FILE *fp = fopen(fname, "r");
+    if (!fp) { perror("open dist file"); MPI_Abort(MPI_COMM_WORLD, 1); }
+
+    if (format == FORMAT_BINARY) {
+        BinaryHeader h;
+        if (fread(&h, sizeof(h), 1, fp) == 1) n = (int)h.n;
+    } else if (format == FORMAT_COORDS) {
+        int k, cx, cy;
+        while (fscanf(fp, " City %d: ( %d , %d )", &k, &cx, &cy) == 3)
+            if (k + 1 > n) n = k + 1;
+    } else if (fscanf(fp, "%d", &n) != 1) {
+        n = 0;
+    }
+    fclose(fp);
+
+    if (n <= 0 || n > MAX_N) {
+        fprintf(stderr, "%s: invalid N=%d (must be 1-%d)\n", fname, n, MAX_N);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    return n;
+}
+
+/* One instance path per line; blank lines and '#' comments are skipped */
+static void read_manifest(const char *fname, Manifest *m)
+{
+    FILE *fp = fopen(fname, "r");
+    if (!fp) { perror("open manifest"); MPI_Abort(MPI_COMM_WORLD, 1); }
+
+    int cap = 64;
+    m->name = malloc(cap * sizeof(*m->name));
+    if (!m->name) { perror("malloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+
+    char line[FILE_NAME_MAX];
+    while (fgets(line, sizeof(line), fp)) {
+        char *s = line, *e;
+        while (*s == ' ' || *s == '\t') s++;
+        for (e = s + strlen(s); e > s && (e[-1] == '\n' || e[-1] == '\r' ||
+                                          e[-1] == ' ' || e[-1] == '\t'); e--)
+            ;
+        *e = '\0';
+        if (*s == '\0' || *s == '#') continue;
+
+        if (m->count == cap) {
+            cap *= 2;
+            m->name = realloc(m->name, cap * sizeof(*m->name));
+            if (!m->name) { perror("realloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+        }
+        strcpy(m->name[m->count++], s);
+    }
+    fclose(fp);
+
+    m->n = malloc((m->count + 1) * sizeof(int));
+    if (!m->n) { perror("malloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+    for (int i = 0; i < m->count; i++)
+        m->n[i] = instance_size(m->name[i]);
+}
+
+static int batch_class(int n)
+{
+    if (n <= 12) return 0;
+    int k = (n - 11) / 2;                       /* 13-14: 1, 15-16: 2 */
+    return k < BATCH_CLASSES - 1 ? k : BATCH_CLASSES - 1;
+}
+
+static double batch_work(int n)
+{
+    double w = (double)n * n;
+    for (int i = 0; i < n; i++) w *= 2.0;
+    return w;
+}
+
+/* Claim the next instance: own class first, then the others from the
+ * largest down.  Returns -1 once every instance is taken.  Called by
+ * group leaders only. */
+static int batch_claim(MPI_Win win, int own, int *const members[],
+                       const int count[])
+{
+    const int one = 1;
+    for (int t = -1; t < BATCH_CLASSES; t++) {
+        int k = t < 0 ? own : BATCH_CLASSES - 1 - t;
+        if ((t >= 0 && k == own) || count[k] == 0) continue;
+
+        int idx;
+        MPI_Fetch_and_op(&one, &idx, MPI_INT, 0, k, MPI_SUM, win);
+        MPI_Win_flush(0, win);
+        if (idx < count[k]) return members[k][idx];
+    }
+    return -1;
+}
+
+static void run_batch(const char *manifest, const char *outname)
+{
+    int rank, world;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &world);
+    double t0 = MPI_Wtime();
+
+    Manifest m = { 0 };
+    if (rank == 0) read_manifest(manifest, &m);
+    MPI_Bcast(&m.count, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (rank != 0) {
+        m.n = malloc((m.count + 1) * sizeof(int));
+        m.name = malloc((m.count + 1) * sizeof(*m.name));
+        if (!m.n || !m.name) { perror("malloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+    }
+    MPI_Bcast(m.n, m.count, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(m.name, m.count * FILE_NAME_MAX, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+    /* Bin by class, largest instances first within each class */
+    int count[BATCH_CLASSES] = { 0 };
+    int *members[BATCH_CLASSES];
+    double work[BATCH_CLASSES] = { 0 };
+    for (int k = 0; k < BATCH_CLASSES; k++) {
+        members[k] = malloc((m.count + 1) * sizeof(int));
+        if (!members[k]) { perror("malloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+    }
+    for (int i = 0; i < m.count; i++) {
+        int k = batch_class(m.n[i]), j = count[k]++;
+        for (; j > 0 && m.n[members[k][j - 1]] < m.n[i]; j--)
+            members[k][j] = members[k][j - 1];
+        members[k][j] = i;
+        work[k] += batch_work(m.n[i]);
+    }
+
+    /* Every rank plans the same groups: one per non-empty class (larger
+     * classes first, shrunk to the ranks left), then extra groups to
+     * whichever class has the most work per rank, while they fit */
+    int size[BATCH_CLASSES], groups[BATCH_CLASSES] = { 0 }, left = world;
+    for (int k = BATCH_CLASSES - 1; k >= 0; k--) {
+        size[k] = 1 << k;
+        if (size[k] > world) size[k] = world;
+        if (count[k] == 0 || left == 0) continue;
+        if (size[k] > left) size[k] = left;
+        groups[k] = 1;
+        left -= size[k];
+    }
+    for (;;) {
+        int best = -1;
+        double best_share = 0;
+        for (int k = 0; k < BATCH_CLASSES; k++) {
+            if (!groups[k] || groups[k] >= count[k] || size[k] > left) continue;
+            double share = work[k] / (groups[k] * size[k]);
+            if (share > best_share) { best_share = share; best = k; }
+        }
+        if (best < 0) break;
+        groups[best]++;
+        left -= size[best];
+    }
+
+    /* Ranks are dealt out consecutively; leftovers sit the batch out */
+    int color = MPI_UNDEFINED, own = 0, ngroups = 0, first = 0;
+    for (int k = BATCH_CLASSES - 1; k >= 0; k--)
+        for (int g = 0; g < groups[k]; g++, ngroups++, first += size[k])
+            if (rank >= first && rank < first + size[k]) { color = ngroups; own = k; }
+
+    if (rank == 0) {
+        printf("Batch: %d instances from %s, %d groups of", m.count, manifest, ngroups);
+        for (int k = BATCH_CLASSES - 1; k >= 0; k--)
+            if (groups[k]) printf(" %dx%d", groups[k], size[k]);
+        printf(" ranks");
+        if (left) printf(", %d idle", left);
+        printf("\n");
+        fflush(stdout);
+    }
+
+    MPI_Comm group;
+    MPI_Comm_split(MPI_COMM_WORLD, color, rank, &group);
+
+    /* Claim counters, one per class, live on world rank 0 */
+    int *counters;
+    MPI_Win win;
+    MPI_Win_allocate(rank == 0 ? BATCH_CLASSES * sizeof(int) : 0, sizeof(int),
+                     MPI_INFO_NULL, MPI_COMM_WORLD, &counters, &win);
+    if (rank == 0) memset(counters, 0, BATCH_CLASSES * sizeof(int));
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Win_lock_all(0, win);
+
+    MPI_File fh;
+    if (MPI_File_open(MPI_COMM_WORLD, outname, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                      MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+        if (rank == 0) fprintf(stderr, "%s: cannot open results file\n", outname);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_File_set_size(fh, 0);
+
+    int grank = 0, gsize = 0;
+    if (group != MPI_COMM_NULL) {
+        MPI_Comm_rank(group, &grank);
+        MPI_Comm_size(group, &gsize);
+        comm = group;
+        node_init();
+        comm = MPI_COMM_WORLD;
+    }
+
+    /* Open MPI names the shared segment behind a window after its
+     * communicator's context id, which sibling groups share, so groups
+     * create their incumbent windows one at a time */
+    for (int g = 0; g < ngroups; g++) {
+        if (g == color && node.nodes > 1 && node.rank == 0) incumbent_init();
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+
+    int solved = 0;
+    if (group != MPI_COMM_NULL) {
+        const Options base = opts;
+        comm = group;
+        quiet = 1;
+
+        for (;;) {
+            int inst = grank == 0 ? batch_claim(win, own, members, count) : -1;
+            MPI_Bcast(&inst, 1, MPI_INT, 0, group);
+            if (inst < 0) break;
+
+            SolveResult res;
+            opts = base;
+            solve_instance(m.name[inst], &res);
+            if (grank != 0) continue;
+
+            /* Lines are short; one shared-pointer write keeps each whole */
+            char line[FILE_NAME_MAX + 16 * MAX_PATH + 128];
+            int len = snprintf(line, sizeof(line), "%s N=%d ranks=%d time=%.3f",
+                               m.name[inst], N, gsize, res.seconds);
+            if (res.cost < INT_MAX) {
+                len += snprintf(line + len, sizeof(line) - len, " tour=%d", res.cost);
+                if (res.bound < res.cost)
+                    len += snprintf(line + len, sizeof(line) - len, " bound=%d", res.bound);
+                len += snprintf(line + len, sizeof(line) - len, " path=");
+                for (int i = 0; i <= N; i++)
+                    len += snprintf(line + len, sizeof(line) - len, i ? ",%d" : "%d",
+                                    res.path[i]);
+            } else {
+                len += snprintf(line + len, sizeof(line) - len, " tour=none");
+            }
+            line[len++] = '\n';
+            MPI_File_write_shared(fh, line, len, MPI_CHAR, MPI_STATUS_IGNORE);
+            solved++;
+        }
+
+        incumbent_free();
+        node_free();
+        opts = base;
+        quiet = 0;
+        comm = MPI_COMM_WORLD;
+        MPI_Comm_free(&group);
+    }
+
+    MPI_File_close(&fh);
+    MPI_Win_unlock_all(win);
+    MPI_Win_free(&win);
+
+    int total = 0;
+    MPI_Reduce(&solved, &total, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    double t1 = MPI_Wtime();
+    if (rank == 0)
+        printf("Batch: %d of %d instances solved in %.3f s, results in %s\n",
+               total, m.count, t1 - t0, outname);
+
+    for (int k = 0; k < BATCH_CLASSES; k++) free(members[k]);
+    free(m.n);
+    free(m.name);
+}
+
+#ifdef WSP_BENCH
+/* --------------------------------------------------------------------
+ *  Benchmark harness (make wsp-bench).  Every instance is solved
+ *  in-process for each thread count: warm-up runs first, then timed
+ *  runs whose median and minimum go to one CSV row.  Timing is
+ *  res.seconds, so MPI start-up, input and the instance setup are left
+ *  out.  Strong scaling crosses every file with every thread count and
+ *  compares each median with the file's first; --weak pairs file i with
+ *  thread count i and compares throughput per core with the first pair.
+ * --------------------------------------------------------------------*/
+#define BENCH_MAX_FILES   64
+#define BENCH_MAX_THREADS 16
+
+typedef struct {
+    const char *file[BENCH_MAX_FILES];
+    int files;
+    int threads[BENCH_MAX_THREADS];
+    int sweeps;             /* thread counts given (0 = OpenMP default) */
+    int runs, warmup;
+    int weak;
+    const char *csv;        /* NULL = stdout */
+    const char *label;      /* first column, e.g. a commit id */
+} BenchOptions;
+
+static BenchOptions bench = { .runs = 5, .warmup = 1, .label = "" };
+
+/* "1,2,4" into bench.threads */
+static int bench_thread_list(const char *list)
+{
+    bench.sweeps = 0;
+    while (*list) {
+        char *end;
+        long t = strtol(list, &end, 10);
+        if (end == list || t < 1 || bench.sweeps == BENCH_MAX_THREADS) return 1;
+        bench.threads[bench.sweeps++] = (int)t;
+        list = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return 1;
+    }
+    return bench.sweeps == 0;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void run_bench(void)
+{
+    int rank, world;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &world);
+
+    if (bench.sweeps == 0) {
+        #ifdef _OPENMP
+        bench.threads[0] = omp_get_max_threads();
+        #else
+        bench.threads[0] = 1;
+        #endif
+        bench.sweeps = 1;
+    }
+    #ifndef _OPENMP
+    for (int s = 0; s < bench.sweeps; s++) bench.threads[s] = 1;
+    #endif
+    if (bench.weak && bench.sweeps != bench.files) {
+        if (rank == 0)
+            fprintf(stderr, "--weak needs one thread count per file (%d files, %d counts)\n",
+                    bench.files, bench.sweeps);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    FILE *fp = stdout;
+    if (rank == 0) {
+        if (bench.csv) fp = fopen(bench.csv, "w");
+        if (!fp) { perror("open csv file"); MPI_Abort(MPI_COMM_WORLD, 1); }
+        fprintf(fp, "label,instance,n,engine,ranks,threads,warmup,runs,cost,"
+                "min_s,median_s,nodes,nodes_per_s,speedup,efficiency\n");
+        fflush(fp);
+    }
+
+    double *times = malloc(bench.runs * sizeof(double));
+    if (!times) { perror("malloc"); MPI_Abort(MPI_COMM_WORLD, 1); }
+
+    const Options base = opts;
+    quiet = 1;
+    double base_time = 0, base_rate = 0;
+    int base_cores = 1;
+
+    const int rows = bench.weak ? bench.files : bench.files * bench.sweeps;
+    for (int row = 0; row < rows; row++) {
+        const int f = bench.weak ? row : row / bench.sweeps;
+        const int threads = bench.threads[bench.weak ? row : row % bench.sweeps];
+        const int cores = world * threads;
+        #ifdef _OPENMP
+        omp_set_num_threads(threads);
+        #endif
+
+        SolveResult res;
+        uint64_t nodes = 0;
+        int cost = INT_MAX, consistent = 1;
+        for (int r = -bench.warmup; r < bench.runs; r++) {
+            opts = base;
+            solve_instance(bench.file[f], &res);
+            uint64_t expanded;
+            MPI_Reduce(&stats.total.expanded, &expanded, 1, MPI_UINT64_T, MPI_SUM, 0, comm);
+            if (rank != 0) continue;
+            if (r == -bench.warmup) cost = res.cost;
+            else if (res.cost != cost) consistent = 0;
+            if (r < 0) continue;
+            times[r] = res.seconds;
+            nodes += expanded;
+        }
+        if (rank != 0) continue;
+
+        if (!consistent)
+            fprintf(stderr, "%s: tour cost differs between runs\n", bench.file[f]);
+        qsort(times, bench.runs, sizeof(double), compare_double);
+        double median = bench.runs % 2 ? times[bench.runs / 2]
+                      : (times[bench.runs / 2 - 1] + times[bench.runs / 2]) / 2;
+        double total = 0;
+        for (int r = 0; r < bench.runs; r++) total += times[r];
+        double per_run = (double)nodes / bench.runs;
+        double rate = total > 0 ? nodes / total : 0;
+
+        /* Speedup against the baseline run: the file's first thread
+         * count (strong), or the first pair's throughput (weak) */
+        if (bench.weak ? row == 0 : row % bench.sweeps == 0) {
+            base_time = median;
+            base_rate = rate;
+            base_cores = cores;
+        }
+        double speedup = bench.weak ? (base_rate > 0 ? rate / base_rate : 0)
+                                    : (median > 0 ? base_time / median : 0);
+        double efficiency = speedup * base_cores / cores;
+
+        for (const char *c = bench.label; *c; c++)
+            fputc(*c == ',' ? ';' : *c, fp);
+        fputc(',', fp);
+        for (const char *c = bench.file[f]; *c; c++)
+            fputc(*c == ',' ? ';' : *c, fp);
+        fprintf(fp, ",%d,%s,%d,%d,%d,%d,", N, opts.engine == ENGINE_HK ? "hk" : "bb",
+                world, threads, bench.warmup, bench.runs);
+        if (cost < INT_MAX) fprintf(fp, "%d", cost);
+        fprintf(fp, ",%.6f,%.6f,%.0f,%.0f,%.3f,%.3f\n", times[0], median, per_run,
+                rate, speedup, efficiency);
+        fflush(fp);
+    }
+
+    opts = base;
+    quiet = 0;
+    free(times);
+    if (rank == 0 && fp != stdout) fclose(fp);
+}
+#endif
+
+/* --------------------------------------------------------------------
+ *  Tuning profiles.  --autotune probes configurations on one instance, each
+ *  stopped after --autotune-budget seconds, and records the winner for that
+ *  city count and rank count as one line of a profile file:
+ *
+ *    n=17 ranks=4 threads=2 seed_depth=3 bound=2edge seconds=0.412
+ *
+ *  --profile reads the file back.  The entry with the nearest n is the
+ *  instance's size class; among those the current rank count wins,
+ *  else the fastest.  run_job.sh and submitjob.py use the same rule to
+ *  choose ranks per node and OMP_NUM_THREADS.
+ * --------------------------------------------------------------------*/
+typedef struct {
+    int n, ranks, threads;
+    int seed_depth;         /* 0 = auto */
+    int bound;              /* BOUND_2EDGE or BOUND_1TREE */
+    double seconds;         /* the probe's score */
+} ProfileEntry;
+
+/* Entries of `fname` into e[0..max); a missing file has none */
+static int profile_read(const char *fname, ProfileEntry *e, int max)
+{
+    FILE *fp = fopen(fname, "r");
+    if (!fp) return 0;
+
+    int count = 0;
+    char line[256], bound[16];
+    while (count < max && fgets(line, sizeof(line), fp)) {
+        ProfileEntry *p = &e[count];
+        if (sscanf(line, " n=%d ranks=%d threads=%d seed_depth=%d bound=%15s seconds=%lf",
+                   &p->n, &p->ranks, &p->threads, &p->seed_depth, bound, &p->seconds) != 6)
+            continue;                           /* comments, blank lines */
+        p->bound = strcmp(bound, "1tree") == 0 ? BOUND_1TREE : BOUND_2EDGE;
+        count++;
+    }
+    fclose(fp);
+    return count;
+}
+
+/* Nearest n, then `ranks`, then fastest; -1 if the profile is empty */
+static int profile_pick(const ProfileEntry *e, int count, int n, int ranks)
+{
+    int best = -1;
+    for (int i = 0; i < count; i++) {
+        if (best < 0) { best = i; continue; }
+        int d = abs(e[i].n - n), bd = abs(e[best].n - n);
+        int same = e[i].ranks == ranks, bsame = e[best].ranks == ranks;
+        if (d < bd || (d == bd && (same > bsame ||
+                                   (same == bsame && e[i].seconds < e[best].seconds))))
+            best = i;
+    }
+    return best;
+}
+
+/* Start from the profile's settings for `fname`; the command line is
+ * parsed again afterwards, so explicit options still win */
+static void profile_apply(const char *fname)
+{
+    int rank, world;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &world);
+
+    ProfileEntry pick = { 0 };
+    int found = 0;
+    if (rank == 0) {
+        ProfileEntry e[PROFILE_MAX];
+        int count = profile_read(opts.profile, e, PROFILE_MAX);
+        int i = profile_pick(e, count, instance_size(fname), world);
+        if (i >= 0) { pick = e[i]; found = 1; }
+        else fprintf(stderr, "%s: no tuned entries, using defaults\n", opts.profile);
+    }
+    MPI_Bcast(&found, 1, MPI_INT, 0, comm);
+    if (!found) return;
+    MPI_Bcast(&pick, sizeof(pick), MPI_BYTE, 0, comm);
+
+    opts.seed_depth = pick.seed_depth;
+    opts.bound = pick.bound;
+    #ifdef _OPENMP
+    if (!getenv("OMP_NUM_THREADS")) omp_set_num_threads(pick.threads);
+    #endif
+
+    if (rank == 0)
+        printf("Profile: tuned on n=%d with %d ranks: %d threads, seed depth %d, %s bound\n",
+               pick.n, pick.ranks, pick.threads, pick.seed_depth,
+               pick.bound == BOUND_1TREE ? "1tree" : "2edge");
+}
+
+/* One time-boxed solve with these settings.  Finished runs score their
+ * time; stopped ones the whole budget, inflated by the gap still open.
+ * The score is the same on every rank. */
+static double tune_probe(const char *fname, const Options *base, const ProfileEntry *cfg)
+{
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    opts = *base;
+    opts.seed_depth = cfg->seed_depth;
+    opts.bound = cfg->bound;
+    opts.time_limit = opts.tune_budget;
+    #ifdef _OPENMP
+    omp_set_num_threads(cfg->threads);
+    #endif
+
+    SolveResult res;
+    solve_instance(fname, &res);
+
+    double score = 0;
+    if (rank == 0) {
+        if (res.bound >= res.cost) {
+            score = res.seconds;
+        } else {
+            double gap = res.cost < INT_MAX && res.bound > 0
+                       ? (double)(res.cost - res.bound) / res.bound : 1.0;
+            score = opts.tune_budget * (1.0 + gap);
+        }
+        printf("Probe: %2d threads, seed depth %d, %s bound: %8.3f s%s\n", cfg->threads,
+               cfg->seed_depth, cfg->bound == BOUND_1TREE ? "1tree" : "2edge", score,
+               res.bound >= res.cost ? "" : " (stopped)");
+        fflush(stdout);
+    }
+    MPI_Bcast(&score, 1, MPI_DOUBLE, 0, comm);
+    return score;
+}
+
+/* Coordinate descent: threads per rank, then seeding depth, then bound,
+ * keeping the best of each before moving on.  Collective. */
+static void run_tune(const char *fname)
+{
+    const char *profile = opts.tune;
+    int rank, world;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &world);
+    #ifdef _OPENMP
+    const int max_threads = omp_get_max_threads();
+    #else
+    const int max_threads = 1;
+    #endif
+
+    const Options base = opts;
+    quiet = 1;
+
+    ProfileEntry best = { .ranks = world, .threads = max_threads,
+                          .seed_depth = base.seed_depth, .bound = base.bound };
+    best.seconds = tune_probe(fname, &base, &best);
+    best.n = N;
+
+    for (int t = max_threads / 2; t >= 1; t /= 2) {
+        ProfileEntry cfg = best;
+        cfg.threads = t;
+        if ((cfg.seconds = tune_probe(fname, &base, &cfg)) < best.seconds) best = cfg;
+    }
+
+    const int depths[] = { 0, 2, 3, 4, 5, 6 };
+    const int start_depth = best.seed_depth;
+    for (size_t i = 0; i < sizeof(depths) / sizeof(depths[0]); i++) {
+        if (depths[i] == start_depth || depths[i] >= N - 1) continue;
+        ProfileEntry cfg = best;
+        cfg.seed_depth = depths[i];
+        if ((cfg.seconds = tune_probe(fname, &base, &cfg)) < best.seconds) best = cfg;
+    }
+
+    ProfileEntry cfg = best;
+    cfg.bound = best.bound == BOUND_1TREE ? BOUND_2EDGE : BOUND_1TREE;
+    if ((cfg.seconds = tune_probe(fname, &base, &cfg)) < best.seconds) best = cfg;
+
+    opts = base;
+    quiet = 0;
+    if (rank != 0) return;
+
+    /* Replace this (n, ranks) entry, keep the others */
+    ProfileEntry e[PROFILE_MAX];
+    int count = profile_read(profile, e, PROFILE_MAX), kept = 0;
+    for (int i = 0; i < count; i++)
+        if (e[i].n != best.n || e[i].ranks != best.ranks) e[kept++] = e[i];
+    if (kept == PROFILE_MAX) kept--;
+    e[kept++] = best;
+
+    FILE *fp = fopen(profile, "w");
+    if (!fp) { perror("open profile"); MPI_Abort(MPI_COMM_WORLD, 1); }
+    fprintf(fp, "# wsp-mpi_v4 --autotune profile: one line per city count and rank count\n");
+    for (int i = 0; i < kept; i++)
+        fprintf(fp, "n=%d ranks=%d threads=%d seed_depth=%d bound=%s seconds=%.3f\n",
+                e[i].n, e[i].ranks, e[i].threads, e[i].seed_depth,
+                e[i].bound == BOUND_1TREE ? "1tree" : "2edge", e[i].seconds);
+    fclose(fp);
+
+    printf("Tuned n=%d on %d ranks: %d threads, seed depth %d, %s bound (%.3f s), saved to %s\n",
+           best.n, world, best.threads, best.seed_depth,
+           best.bound == BOUND_1TREE ? "1tree" : "2edge", best.seconds, profile);
+}
+
+/* Parse "[options] <distance-file>" or "[options] --batch MANIFEST
+ * <results-file>"; returns nonzero on bad usage */
+static int parse_args(int argc, char **argv, const char **fname)
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "bb") == 0) opts.engine = ENGINE_BB;
+            else if (strcmp(argv[i], "hk") == 0) opts.engine = ENGINE_HK;
+            else return 1;
+        } else if (strcmp(argv[i], "--bound") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "2edge") == 0) opts.bound = BOUND_2EDGE;
+            else if (strcmp(argv[i], "1tree") == 0) opts.bound = BOUND_1TREE;
+            else return 1;
+        } else if (strcmp(argv[i], "--bound-depth") == 0 && i + 1 < argc) {
+            opts.bound_depth = atoi(argv[++i]);
+            if (opts.bound_depth < 0) return 1;
+        } else if (strcmp(argv[i], "--no-warm-start") == 0) {
+            opts.no_warm_start = 1;
+        } else if (strcmp(argv[i], "--tt-mb") == 0 && i + 1 < argc) {
+            opts.tt_mb = atoi(argv[++i]);
+            if (opts.tt_mb < 0) return 1;
+        } else if (strcmp(argv[i], "--tt-policy") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "depth") == 0) opts.tt_policy = TT_DEPTH;
+            else if (strcmp(argv[i], "always") == 0) opts.tt_policy = TT_ALWAYS;
+            else return 1;
+        } else if (strcmp(argv[i], "--tt-merge") == 0) {
+            opts.tt_merge = 1;
+        } else if (strcmp(argv[i], "--suffix-k") == 0 && i + 1 < argc) {
+            opts.suffix_k = atoi(argv[++i]);
+            if (opts.suffix_k < 0) return 1;
+        } else if (strcmp(argv[i], "--no-symmetry") == 0) {
+            opts.no_symmetry = 1;
+        } else if (strcmp(argv[i], "--seed-depth") == 0 && i + 1 < argc) {
+            opts.seed_depth = atoi(argv[++i]);
+            if (opts.seed_depth < 1) return 1;
+        } else if (strcmp(argv[i], "--seed-tasks") == 0 && i + 1 < argc) {
+            opts.seed_tasks = atoi(argv[++i]);
+            if (opts.seed_tasks < 1) return 1;
+        } else if (strcmp(argv[i], "--probes") == 0 && i + 1 < argc) {
+            opts.probes = atoi(argv[++i]);
+            if (opts.probes < 0) return 1;
+        } else if (strcmp(argv[i], "--best-first") == 0 && i + 1 < argc) {
+            opts.best_first_mb = atoi(argv[++i]);
+            if (opts.best_first_mb < 0) return 1;
+        } else if (strcmp(argv[i], "--numa") == 0) {
+            opts.numa = 1;
+        } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            opts.profile = argv[++i];
+        } else if (strcmp(argv[i], "--autotune") == 0 && i + 1 < argc) {
+            opts.tune = argv[++i];
+        } else if (strcmp(argv[i], "--autotune-budget") == 0 && i + 1 < argc) {
+            opts.tune_budget = atof(argv[++i]);
+            if (opts.tune_budget <= 0) return 1;
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            opts.batch = argv[++i];
+        } else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            opts.checkpoint = argv[++i];
+            if (strlen(opts.checkpoint) >= FILE_NAME_MAX) return 1;
+        } else if (strcmp(argv[i], "--checkpoint-interval") == 0 && i + 1 < argc) {
+            opts.checkpoint_interval = atoi(argv[++i]);
+            if (opts.checkpoint_interval < 1) return 1;
+        } else if (strcmp(argv[i], "--restart") == 0) {
+            opts.restart = 1;
+        } else if (strcmp(argv[i], "--time-limit") == 0 && i + 1 < argc) {
+            opts.time_limit = atof(argv[++i]);
+            if (opts.time_limit <= 0) return 1;
+        } else if (strcmp(argv[i], "--gap") == 0 && i + 1 < argc) {
+            opts.gap = atof(argv[++i]);
+            if (opts.gap < 0) return 1;
+#ifndef WSP_NO_STATS
+        } else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+            opts.stats = argv[++i];
+#endif
+#ifndef WSP_NO_TRACE
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            opts.trace = argv[++i];
+#endif
+#ifdef WSP_BENCH
+        } else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            bench.runs = atoi(argv[++i]);
+            if (bench.runs < 1) return 1;
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            bench.warmup = atoi(argv[++i]);
+            if (bench.warmup < 0) return 1;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            if (bench_thread_list(argv[++i])) return 1;
+        } else if (strcmp(argv[i], "--weak") == 0) {
+            bench.weak = 1;
+        } else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            bench.csv = argv[++i];
+        } else if (strcmp(argv[i], "--label") == 0 && i + 1 < argc) {
+            bench.label = argv[++i];
+        } else if (argv[i][0] != '-') {
+            /* Every file is benchmarked; fname is the first */
+            if (bench.files == BENCH_MAX_FILES) return 1;
+            bench.file[bench.files++] = argv[i];
+            if (!*fname) *fname = argv[i];
+#endif
+        } else if (argv[i][0] == '-' || *fname) {
+            return 1;
+        } else {
+            *fname = argv[i];
+        }
+    }
+    if (opts.restart && !opts.checkpoint) return 1;
+    if (opts.batch && (opts.checkpoint || opts.stats || opts.trace)) return 1;
+    if ((opts.tune || opts.profile) && (opts.batch || opts.checkpoint)) return 1;
+    if (opts.tune && (opts.engine == ENGINE_HK || opts.time_limit > 0 || opts.gap >= 0))
+        return 1;
+#ifdef WSP_BENCH
+    if (opts.batch || opts.checkpoint) return 1;
+#endif
+    return *fname == NULL;
+}
+
+int main(int argc, char **argv)
+{
+    #ifdef _OPENMP
+    /* Only the master thread of each rank makes MPI calls */
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    /* The master thread steals, exchanges incumbents and checkpoints from
+     * inside the parallel region */
+    if (provided < MPI_THREAD_FUNNELED) {
+        fprintf(stderr, "MPI library provides thread level %d; MPI_THREAD_FUNNELED is required\n",
+                provided);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    #else
+    MPI_Init(&argc, &argv);
+    #endif
+
+    comm = MPI_COMM_WORLD;
+
+    int rank, world;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &world);
+
+    const char *fname = NULL;
+    if (parse_args(argc, argv, &fname) != 0) {
+        if (rank == 0)
+            fprintf(stderr, "usage: %s [--engine bb|hk] [--bound 2edge|1tree] [--bound-depth D]\n"
+                    "       [--no-warm-start] [--tt-mb M] [--tt-policy depth|always] [--tt-merge]\n"
+                    "       [--suffix-k K] [--no-symmetry] [--numa]\n"
+                    "       [--checkpoint PREFIX [--checkpoint-interval S] [--restart]]\n"
+                    "       [--stats FILE|-] [--trace FILE] [--time-limit S] [--gap PERCENT]\n"
+                    "       [--seed-depth D] [--seed-tasks T] [--probes P] [--best-first MB]\n"
+                    "       [--profile FILE] <distance-file>\n"
+                    "       %s [options] --batch MANIFEST <results-file>\n"
+                    "       %s [options] --autotune FILE [--autotune-budget S] <distance-file>\n",
+                    argv[0], argv[0], argv[0]);
+#ifdef WSP_BENCH
+        if (rank == 0)
+            fprintf(stderr, "       %s [options] [--runs R] [--warmup W] [--threads T1,T2,...]\n"
+                    "       [--weak] [--csv FILE] [--label TEXT] <distance-file>...\n", argv[0]);
+#endif
+        MPI_Finalize(); 
+        return 1;
+    }
+
+    /* Profile first, then the command line over it */
+    if (opts.profile && !opts.tune) {
+        profile_apply(fname);
+        #ifdef WSP_BENCH
+        bench.files = 0;
+        #endif
+        fname = NULL;
+        parse_args(argc, argv, &fname);
+    }
+
+#ifdef WSP_BENCH
+    run_bench();
+    MPI_Finalize();
+    return 0;
+#endif
+
+    if (opts.tune) {
+        run_tune(fname);
+        MPI_Finalize();
+        return 0;
+    }
+
+    if (opts.batch) {
+        run_batch(opts.batch, fname);
+        MPI_Finalize();
+        return 0;
+    }
+
+    SolveResult res;
+    solve_instance(fname, &res);
+
+    if (rank == 0) {
+        const int proven = res.bound >= res.cost;
+        const char *why = res.stopped == STOP_TIME ? "time limit" : "gap";
+        if (res.cost < INT_MAX) {
+            printf("%s tour cost: %d   time: %.3f s   ranks: %d\n",
+                   proven ? "Optimal" : "Best", res.cost, res.seconds, world);
+            if (!proven && res.bound > 0)
+                printf("Proven bound: %d   gap: %.2f%%   stopped by %s\n", res.bound,
+                       100.0 * (res.cost - res.bound) / res.bound, why);
+            else if (!proven)
+                printf("Proven bound: %d   stopped by %s\n", res.bound, why);
+
+            printf("%s path: ", proven ? "Optimal" : "Best");
             for (int i = 0; i <= N; i++) {
-                printf("%d ", best_path_to_show[i]);
+                printf("%d ", res.path[i]);
             }
             printf("\n");
         } else {
+            /* Stopped before any tour was found: only the bound is known */
+            if (!proven)
+                printf("Proven bound: %d   time: %.3f s   stopped by %s\n", res.bound,
+                       res.seconds, why);
             printf("No solution found!\n");
         }
     }